@@ -0,0 +1,38 @@
+//ARITHMETIC BENCHMARK
+//Interprets a generated straight-line script of integer additions and comparisons and reports time per statement.
+//  g++ -O2 bench/arith_bench.cpp -o arith_bench && ./arith_bench [statements]
+#define MINIPYTHON_NO_MAIN
+#include "../minipython.cpp"
+
+#include <chrono>
+
+int main(int argc, char* argv[]) {
+    int statements = argc > 1 ? stoi(argv[1]) : 200000;
+    const int repetitions = 5;
+
+    //Each group of three statements evaluates four operations
+    string script = "x = 0\ny = 1\n";
+    for (int i = 0; i < statements / 3; i++) {
+        script += "x = x + 1\n";
+        script += "y = x + x + 3\n";
+        script += "c = x >= y\n";
+    }
+    script += "print(\"x y: \", x, y)\n";
+
+    AST ast = prepare(script);
+
+    //Keep the fastest repetition to filter out noise
+    double best = 0;
+    for (int i = 0; i < repetitions; i++) {
+        environment.reset();
+        auto start = chrono::steady_clock::now();
+        interpret(ast.root());
+        double elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        if (i == 0 || elapsed < best) best = elapsed;
+    }
+
+    cout << "Statements: " << ast.root().children().size() << endl;
+    cout << "Interpret (ms): " << best << endl;
+    cout << "ns/statement: " << best * 1e6 / ast.root().children().size() << endl;
+    return 0;
+}
@@ -0,0 +1,62 @@
+//PARALLEL BATCH BENCHMARK
+//Throughput of a batch of small scripts (the tests/ fixtures without errors, repeated) run one after the other and on
+//2, 4, ... worker threads, up to the number of cores or the given number of jobs, with both engines.
+//Printed output goes to /dev/null, results are reported on stderr.
+//  g++ -std=c++17 -O2 bench/batch_bench.cpp -o batch_bench && ./batch_bench [copies] [jobs]
+#define MINIPYTHON_NO_MAIN
+#include "../minipython.cpp"
+
+//Milliseconds of the fastest of three runs of the batch
+double timeBatch(const vector<string>& scripts, const string& engine, int jobs) {
+    double best = 0;
+    for (int attempt = 0; attempt < 3; attempt++) {
+        int failed = 0;
+        size_t lines = 0;
+        auto start = chrono::steady_clock::now();
+        if (jobs > 1) {
+            runParallel(scripts, engine, false, jobs, failed, lines);
+        } else {
+            for (const string& path : scripts) runBatchScript(path, engine, false, lines);
+        }
+        output.flush();
+        double elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        if (attempt == 0 || elapsed < best) best = elapsed;
+    }
+    return best;
+}
+
+int main(int argc, char* argv[]) {
+    int copies = argc > 1 ? stoi(argv[1]) : 200;
+    int cores = argc > 2 ? stoi(argv[2]) : max(1u, thread::hardware_concurrency());
+
+    int devNull = open("/dev/null", O_WRONLY);
+    dup2(devNull, STDOUT_FILENO);
+    close(devNull);
+
+    //Fixtures that end with an ERROR are left out, the batch would report every one of them
+    vector<string> fixtures;
+    for (const auto& entry : filesystem::directory_iterator("tests")) {
+        size_t lines = 0;
+        string path = entry.path().string();
+        if (entry.path().extension() == ".py" && runBatchScript(path, "tree", false, lines)) fixtures.push_back(path);
+    }
+    sort(fixtures.begin(), fixtures.end());
+    vector<string> scripts;
+    for (int i = 0; i < copies; i++) scripts.insert(scripts.end(), fixtures.begin(), fixtures.end());
+
+    cerr << "Scripts: " << scripts.size() << ", cores: " << cores << endl;
+    cerr << left << setw(8) << "Engine" << setw(8) << "Jobs" << setw(12) << "Time (ms)" << setw(14) << "Scripts/s" << "Speedup" << endl;
+    vector<int> jobCounts;
+    for (int jobs = 1; jobs < cores; jobs *= 2) jobCounts.push_back(jobs);
+    jobCounts.push_back(cores);
+    for (const string engine : {"tree", "vm"}) {
+        double sequential = 0;
+        for (int jobs : jobCounts) {
+            double milliseconds = timeBatch(scripts, engine, jobs);
+            if (jobs == 1) sequential = milliseconds;
+            cerr << setw(8) << engine << setw(8) << jobs << setw(12) << milliseconds << setw(14)
+                 << scripts.size() * 1000 / milliseconds << sequential / milliseconds << "x" << endl;
+        }
+    }
+    return 0;
+}
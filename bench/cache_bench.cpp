@@ -0,0 +1,69 @@
+//AST CACHE BENCHMARK
+//Startup of a large script (copies of tests/in14.py) without the AST cache (cold: lexer, parser, resolver and optimizer)
+//and with it (warm: hash the script and load its cache file). The script and its cache are written to /tmp.
+//  g++ -O2 bench/cache_bench.cpp -o cache_bench && ./cache_bench [copies]
+#define MINIPYTHON_NO_MAIN
+#include "../minipython.cpp"
+
+#include <chrono>
+
+double elapsedSince(chrono::steady_clock::time_point start) {
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char* argv[]) {
+    int copies = argc > 1 ? stoi(argv[1]) : 2000;
+    const int repetitions = 5;
+
+    string script = getInput("tests/in14.py");
+    if (script.back() != '\n') script += '\n';
+    string path = "/tmp/minipython_cache_bench.py";
+    {
+        ofstream file(path, ios::binary);
+        for (int i = 0; i < copies; i++) file << script;
+    }
+    string cachePath = path + ".cache";
+
+    double cold = 0;
+    double save = 0;
+    double warm = 0;
+    size_t nodes = 0;
+    size_t bytes = 0;
+    for (int i = 0; i < repetitions; i++) {
+        auto start = chrono::steady_clock::now();
+        {
+            SourceFile source(path);
+            AST ast = prepare(source.text());
+            double elapsed = elapsedSince(start);
+            if (i == 0 || elapsed < cold) cold = elapsed;
+
+            start = chrono::steady_clock::now();
+            ASTCache::save(cachePath, source.text(), ast);
+            elapsed = elapsedSince(start);
+            if (i == 0 || elapsed < save) save = elapsed;
+            nodes = ast.nodes.size();
+            bytes = source.text().size();
+        }
+
+        start = chrono::steady_clock::now();
+        {
+            SourceFile source(path);
+            ASTCache cache;
+            AST ast;
+            if (!cache.load(cachePath, source.text(), ast) || ast.nodes.size() != nodes) {
+                cout << "ERROR: the cache was not loaded" << endl;
+                return 1;
+            }
+            double elapsed = elapsedSince(start);
+            if (i == 0 || elapsed < warm) warm = elapsed;
+        }
+    }
+
+    cout << "Script: " << bytes / 1024 << " KB, " << nodes << " nodes, cache: " << filesystem::file_size(cachePath) / 1024 << " KB" << endl;
+    cout << "Cold (ms): " << cold << "\t(cache write: " << save << " ms)" << endl;
+    cout << "Warm (ms): " << warm << endl;
+    cout << "Speedup: " << cold / warm << "x" << endl;
+    filesystem::remove(path);
+    filesystem::remove(cachePath);
+    return 0;
+}
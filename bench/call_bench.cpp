@@ -0,0 +1,32 @@
+//CALL BENCHMARK
+//Calls increment() from tests/in16.py one million times and reports the cost per call.
+//The language has no loops, so a block of unrolled calls is interpreted repeatedly.
+//  g++ -O2 bench/call_bench.cpp -o call_bench && ./call_bench [calls]
+#define MINIPYTHON_NO_MAIN
+#include "../minipython.cpp"
+
+#include <chrono>
+
+int main(int argc, char* argv[]) {
+    int calls = argc > 1 ? stoi(argv[1]) : 1000000;
+    const int unrolled = 10000;
+    const int repetitions = max(1, calls / unrolled);
+
+    string setup = "def increment(val):\n    val = val + 1\n    return val\n\ni=0\n";
+    string body;
+    for (int i = 0; i < unrolled; i++) body += "i = increment(i)\n";
+
+    AST setupAst = prepare(setup);
+    AST bodyAst = prepare(body);
+
+    interpret(setupAst.root());
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < repetitions; i++) interpret(bodyAst.root());
+    double elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    int slot = environment.declare("i");
+    cout << "Calls: " << repetitions * unrolled << " (i = " << environment.global(slot).integer << ")" << endl;
+    cout << "Interpret (ms): " << elapsed << endl;
+    cout << "ns/call: " << elapsed * 1e6 / (repetitions * unrolled) << endl;
+    return 0;
+}
@@ -0,0 +1,97 @@
+//EMBEDDING BENCHMARK
+//Cost of one evaluation of a small script through the library API (minipython.h) with both engines: loaded once and
+//run many times with a new input global, loaded again for every evaluation, and (when ./minipython has been built)
+//one process per evaluation as a host without the library would do. Every evaluation checks its result global and
+//its printed output, the benchmark fails if one of them is wrong.
+//  g++ -std=c++17 -O2 bench/embed_bench.cpp -o embed_bench && ./embed_bench [evaluations]
+#define MINIPYTHON_NO_MAIN
+#include "../minipython.cpp"
+
+#include <spawn.h>
+#include <sys/wait.h>
+
+extern char** environ;
+
+const char* SCRIPT =
+    "def score(a, b):\n"
+    "    c = a + b\n"
+    "    return c\n"
+    "\n"
+    "result = score(x, 10)\n"
+    "if result > 20:\n"
+    "    print(\"big \", result)\n"
+    "else:\n"
+    "    print(\"small \", result)\n";
+
+//Output the script prints for an input
+string expectedOutput(int x) {
+    return (x + 10 > 20 ? "big  " : "small  ") + to_string(x + 10) + " \n";
+}
+
+//Runs one evaluation on an interpreter that has the script loaded, false if the result is wrong
+bool evaluate(minipython::Interpreter& interpreter, string& printed, int x) {
+    printed.clear();
+    interpreter.setGlobal("x", x);
+    if (!interpreter.run()) return false;
+    return interpreter.getGlobal("result") == minipython::ScriptValue(x + 10) && printed == expectedOutput(x);
+}
+
+//Microseconds per evaluation
+double timeEmbedded(minipython::Engine engine, int evaluations, bool reload) {
+    string printed;
+    minipython::Interpreter interpreter;
+    interpreter.setOutput([&printed](string_view text) { printed.append(text); });
+    interpreter.load(SCRIPT, engine);
+
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < evaluations; i++) {
+        if (reload) interpreter.load(SCRIPT, engine);
+        if (!evaluate(interpreter, printed, i % 20)) {
+            cerr << "ERROR: wrong result for x = " << i % 20 << ": " << printed << endl;
+            exit(1);
+        }
+    }
+    return chrono::duration<double, micro>(chrono::steady_clock::now() - start).count() / evaluations;
+}
+
+//Microseconds per evaluation with a process per evaluation, 0 if ./minipython has not been built
+double timeProcesses(const string& engine, int evaluations) {
+    if (!filesystem::exists("minipython")) return 0;
+    string path = filesystem::temp_directory_path().string() + "/minipython_embed_" + to_string(getpid()) + ".py";
+    ofstream(path) << "x = 5\n" << SCRIPT;
+    string engineFlag = "--engine=" + engine;
+    char* arguments[] = {(char*)"./minipython", (char*)engineFlag.c_str(), (char*)path.c_str(), nullptr};
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < evaluations; i++) {
+        pid_t child;
+        int status;
+        if (posix_spawn(&child, "./minipython", &actions, nullptr, arguments, environ) != 0) return 0;
+        waitpid(child, &status, 0);
+    }
+    double elapsed = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count() / evaluations;
+    posix_spawn_file_actions_destroy(&actions);
+    filesystem::remove(path);
+    return elapsed;
+}
+
+int main(int argc, char* argv[]) {
+    int evaluations = argc > 1 ? stoi(argv[1]) : 100000;
+    const int processes = 200;
+
+    cout << "Evaluations: " << evaluations << " (" << processes << " processes)" << endl;
+    cout << "Engine\tLoaded once (us)\tReloaded (us)\tProcess (us)" << endl;
+    const pair<string, minipython::Engine> engines[] = {{"tree", minipython::ENGINE_TREE}, {"vm", minipython::ENGINE_VM}};
+    for (const auto& engine : engines) {
+        double once = timeEmbedded(engine.second, evaluations, false);
+        double reloaded = timeEmbedded(engine.second, evaluations, true);
+        double process = timeProcesses(engine.first, processes);
+        cout << engine.first << "\t" << once << "\t\t\t" << reloaded << "\t\t";
+        if (process > 0) cout << process << endl;
+        else cout << "(build ./minipython)" << endl;
+    }
+    return 0;
+}
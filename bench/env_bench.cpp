@@ -0,0 +1,62 @@
+//ENVIRONMENT BENCHMARK
+//Runs the same loop-unrolled script with a small global table and with a large one (a 100k element list and thousands of globals).
+//Evaluating a node must not depend on the size of the environment, the benchmark fails if the large table is noticeably slower.
+//  g++ -O2 bench/env_bench.cpp -o env_bench && ./env_bench
+#define MINIPYTHON_NO_MAIN
+#include "../minipython.cpp"
+
+#include <chrono>
+
+//Interprets the setup script and returns the time in ms of the fastest run of the body script
+double timeBody(const string& setup, const string& body, int repetitions) {
+    AST setupAst = prepare(setup);
+    AST bodyAst = prepare(body);
+
+    double best = 0;
+    for (int i = 0; i < repetitions; i++) {
+        environment.reset();
+        interpret(setupAst.root());
+        auto start = chrono::steady_clock::now();
+        interpret(bodyAst.root());
+        double elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        if (i == 0 || elapsed < best) best = elapsed;
+    }
+    return best;
+}
+
+int main() {
+    const int statements = 30000;
+    const int listSize = 100000;
+    const int globals = 5000;
+    const int repetitions = 5;
+
+    //Loop-unrolled body, reads and writes globals and indexes the list
+    string body;
+    for (int i = 0; i < statements / 3; i++) {
+        body += "x = x + 1\n";
+        body += "y = big[7] + x\n";
+        body += "z = x >= y\n";
+    }
+
+    string smallSetup = "x = 0\nbig = [0,1,2,3,4,5,6,7]\n";
+
+    string largeSetup = "x = 0\nbig = [";
+    for (int i = 0; i < listSize; i++) largeSetup += to_string(i) + (i == listSize - 1 ? "]\n" : ",");
+    for (int i = 0; i < globals; i++) largeSetup += "g" + to_string(i) + " = [1,2,3]\n";
+
+    double small = timeBody(smallSetup, body, repetitions);
+    double large = timeBody(largeSetup, body, repetitions);
+
+    cout << "Statements: " << statements << endl;
+    cout << "Small environment (ms): " << small << "\tns/statement: " << small * 1e6 / statements << endl;
+    cout << "Large environment (ms): " << large << "\tns/statement: " << large * 1e6 / statements << endl;
+
+    //Hash table lookups get slightly slower with size because of cache misses, copying the table would be orders of magnitude slower
+    double ratio = large / small;
+    cout << "Large/small ratio: " << ratio << "x" << endl;
+    if (ratio > 2) {
+        cout << "ERROR: per node cost scales with the size of the environment" << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,69 @@
+//INDEX ASSIGNMENT BENCHMARK
+//Writes list elements one million times (l[i] = v) on lists of 10, 1000 and 100000 elements, with both engines.
+//Writes happen in place, so the cost per write must not depend on the size of the list: the benchmark fails if the
+//largest list is noticeably slower than the smallest. The language has no loops, a block of unrolled writes is run repeatedly.
+//  g++ -O2 bench/index_bench.cpp -o index_bench && ./index_bench [writes]
+#define MINIPYTHON_NO_MAIN
+#include "../minipython.cpp"
+
+#include <chrono>
+
+//Returns the time in ns per write of the fastest run
+double timeWrites(int size, int writes, bool vm) {
+    const int unrolled = 10000;
+    const int repetitions = max(1, writes / unrolled);
+
+    //The literal is shared with the AST, the last write of the setup makes the variable own its copy
+    string setup = "l = [";
+    for (int i = 0; i < size; i++) setup += (i > 0 ? ", " : "") + to_string(i);
+    setup += "]\nl[0] = 0\n";
+    string body;
+    for (int i = 0; i < unrolled; i++) body += "l[" + to_string((i * 7919) % size) + "] = " + to_string(i) + "\n";
+
+    AST setupAst = prepare(setup);
+    AST bodyAst = prepare(body);
+    Bytecode setupBytecode = compile(setupAst.root());
+    Bytecode bodyBytecode = compile(bodyAst.root());
+
+    double best = 0;
+    for (int attempt = 0; attempt < 3; attempt++) {
+        environment.reset();
+        if (vm) run(setupBytecode); else interpret(setupAst.root());
+        auto start = chrono::steady_clock::now();
+        for (int i = 0; i < repetitions; i++) {
+            if (vm) run(bodyBytecode); else interpret(bodyAst.root());
+        }
+        double elapsed = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / (repetitions * unrolled);
+        if (attempt == 0 || elapsed < best) best = elapsed;
+    }
+    return best;
+}
+
+int main(int argc, char* argv[]) {
+    int writes = argc > 1 ? stoi(argv[1]) : 1000000;
+    const int sizes[] = {10, 1000, 100000};
+
+    cout << "Writes: " << writes << endl;
+    cout << "List size\tTree (ns/write)\tVM (ns/write)" << endl;
+    double firstTree = 0, firstVm = 0, lastTree = 0, lastVm = 0;
+    for (int size : sizes) {
+        double tree = timeWrites(size, writes, false);
+        double vm = timeWrites(size, writes, true);
+        if (firstTree == 0) {
+            firstTree = tree;
+            firstVm = vm;
+        }
+        lastTree = tree;
+        lastVm = vm;
+        cout << size << "\t\t" << tree << "\t\t" << vm << endl;
+    }
+
+    //Copying the list on every write would make the largest list 10000x slower than the smallest
+    double growth = max(lastTree / firstTree, lastVm / firstVm);
+    cout << "Per write cost growth: " << growth << "x" << endl;
+    if (growth > 3) {
+        cout << "ERROR: index assignment is not constant time" << endl;
+        return 1;
+    }
+    return 0;
+}
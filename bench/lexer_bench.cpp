@@ -0,0 +1,87 @@
+//LEXER BENCHMARK
+//Lexes large synthetic inputs with the scalar, SSE2 and AVX2 scanners and reports throughput: copies of a script
+//(tests/in14.py by default) and a script with long runs (deep indentation, long names, comments and strings).
+//All scanners have to produce the same token stream.
+//  g++ -O2 bench/lexer_bench.cpp -o lexer_bench && ./lexer_bench [script.py] [MB]
+#define MINIPYTHON_NO_MAIN
+#include "../minipython.cpp"
+
+#include <chrono>
+
+//Returns the time in ms of the fastest run of the lexer, and the token stream of the last run
+double timeLexer(string_view input, int repetitions, TokenStream& stream) {
+    double best = 0;
+    for (int i = 0; i < repetitions; i++) {
+        auto start = chrono::steady_clock::now();
+        stream = lexer(input);
+        double elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        if (i == 0 || elapsed < best) best = elapsed;
+    }
+    return best;
+}
+
+bool sameTokens(const TokenStream& a, const TokenStream& b) {
+    if (a.tokens.size() != b.tokens.size()) return false;
+    for (int i = 0; i < (int)a.tokens.size(); i++) {
+        const token& x = a.tokens[i];
+        const token& y = b.tokens[i];
+        if (x.type != y.type || x.offset != y.offset || x.length != y.length || x.line != y.line || x.symbol != y.symbol) return false;
+    }
+    return true;
+}
+
+//Lexes an input with every scanner the processor supports, returns false if their token streams differ
+bool compareScanners(const string& name, const string& input, int repetitions) {
+    const pair<string, ScanFunction> scanners[] = {{"scalar", scanScalar}, {"SSE2", scanSSE2}, {"AVX2", scanAVX2}};
+    TokenStream reference;
+    double scalar = 0;
+    cout << name << ": " << input.size() / double(1 << 20) << " MB" << endl;
+    cout << "Scanner\t\tLex (ms)\tMB/s\t\tTokens/s" << endl;
+    for (const auto& scanner : scanners) {
+#ifdef MINIPYTHON_X86
+        if (scanner.second == scanAVX2 && !__builtin_cpu_supports("avx2")) continue;
+#endif
+        scanClass = scanner.second;
+        TokenStream stream;
+        double elapsed = timeLexer(input, repetitions, stream);
+        if (scanner.second == scanScalar) {
+            scalar = elapsed;
+            reference = move(stream);
+        } else if (!sameTokens(reference, stream)) {
+            cout << "ERROR: " << scanner.first << " scanner produced a different token stream" << endl;
+            return false;
+        }
+        double seconds = elapsed / 1000;
+        cout << scanner.first << "\t\t" << elapsed << "\t\t" << input.size() / seconds / (1 << 20) << "\t\t"
+             << reference.tokens.size() / seconds << "\t(" << scalar / elapsed << "x scalar)" << endl;
+    }
+    scanClass = chooseScanner();
+    return true;
+}
+
+//Repeats a script until the input reaches the requested size
+string repeat(const string& script, size_t megabytes) {
+    string input;
+    input.reserve(megabytes << 20);
+    while (input.size() + script.size() <= megabytes << 20) input += script;
+    return input;
+}
+
+int main(int argc, char* argv[]) {
+    string script = getInput(argc > 1 ? argv[1] : "tests/in14.py");
+    if (script.back() != '\n') script += '\n';
+    size_t megabytes = argc > 2 ? stoi(argv[2]) : 16;
+    const int repetitions = 5;
+
+    string longRuns = "def a_function_with_a_rather_long_name_for_testing(first_parameter_name, second_parameter_name):\n";
+    longRuns += "    if first_parameter_name == second_parameter_name:\n";
+    longRuns += "                                        # a comment that goes on for a while, the lexer skips it in one call\n";
+    longRuns += "        a_rather_long_variable_name_for_the_scanner = 1234567890123456789 + 9876543210987654321\n";
+    longRuns += "        return \"a string literal that is long enough to span several vector blocks\"\n";
+    longRuns += "    return first_parameter_name\n";
+
+    if (!compareScanners("Copies of script", repeat(script, megabytes), repetitions)) return 1;
+    cout << endl;
+    if (!compareScanners("Long runs", repeat(longRuns, megabytes), repetitions)) return 1;
+    return 0;
+}
@@ -0,0 +1,54 @@
+//PARSE BENCHMARK
+//Parses scaled versions of a script (tests/in14.py by default) and reports parse time per line.
+//Parse cost has to be linear in file size, so the time per line of the largest input is compared against the smallest one.
+//  g++ -O2 bench/parse_bench.cpp -o parse_bench && ./parse_bench [script.py]
+#define MINIPYTHON_NO_MAIN
+#include "../minipython.cpp"
+
+#include <chrono>
+
+int main(int argc, char* argv[]) {
+    string script = getInput(argc > 1 ? argv[1] : "tests/in14.py");
+    if (script.back() != '\n') script += '\n';
+    int scriptLines = count(script.begin(), script.end(), '\n');
+
+    const int scales[] = {25, 50, 100, 200, 400, 800};
+    const int repetitions = 5;
+    double firstPerLine = 0;
+    double lastPerLine = 0;
+
+    cout << "AST node size: " << sizeof(ASTNode) << " bytes" << endl;
+    cout << "Copies\t\tLines\t\tTokens\t\tNodes\t\tParse (ms)\tns/line" << endl;
+    for (int scale : scales) {
+        string input;
+        input.reserve(script.size() * scale);
+        for (int i = 0; i < scale; i++) input += script;
+        TokenStream tokens = lexer(input);
+
+        //Keep the fastest repetition to filter out noise
+        double best = 0;
+        int nodes = 0;
+        for (int i = 0; i < repetitions; i++) {
+            auto start = chrono::steady_clock::now();
+            AST ast = parseTree(tokens);
+            nodes = ast.nodes.size();
+            double elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+            if (i == 0 || elapsed < best) best = elapsed;
+        }
+
+        int lines = scriptLines * scale;
+        double perLine = best * 1e6 / lines;
+        if (firstPerLine == 0) firstPerLine = perLine;
+        lastPerLine = perLine;
+        cout << scale << "\t\t" << lines << "\t\t" << tokens.tokens.size() << "\t\t" << nodes << "\t\t" << best << "\t\t" << perLine << endl;
+    }
+
+    //Quadratic parsing would make the per line cost grow with the number of copies (32x between first and last scale)
+    double growth = lastPerLine / firstPerLine;
+    cout << "Per line cost growth: " << growth << "x" << endl;
+    if (growth > 3) {
+        cout << "ERROR: parse time is not linear in file size" << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,47 @@
+//PRINT BENCHMARK
+//Interprets a script of print() statements with buffered output and with --unbuffered (one write per line, like endl).
+//Printed lines go to /dev/null, results are reported on stderr.
+//  g++ -O2 bench/print_bench.cpp -o print_bench && ./print_bench [lines]
+#define MINIPYTHON_NO_MAIN
+#include "../minipython.cpp"
+
+#include <chrono>
+
+//Returns the time in ms of the fastest run of the program, flushing included
+double timePrint(const ASTNode& program, bool unbuffered, int repetitions) {
+    output.unbuffered = unbuffered;
+    double best = 0;
+    for (int i = 0; i < repetitions; i++) {
+        environment.reset();
+        auto start = chrono::steady_clock::now();
+        interpret(program);
+        output.flush();
+        double elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        if (i == 0 || elapsed < best) best = elapsed;
+    }
+    return best;
+}
+
+int main(int argc, char* argv[]) {
+    int lines = argc > 1 ? stoi(argv[1]) : 200000;
+    const int repetitions = 3;
+
+    string script = "x = 12345\nl = [1, 22, 333]\n";
+    for (int i = 0; i < lines; i++) script += "print(\"value:\", x, l)\n";
+
+    AST ast = prepare(script);
+
+    //Send printed lines to /dev/null so the terminal does not dominate the measurement
+    int devNull = open("/dev/null", O_WRONLY);
+    dup2(devNull, STDOUT_FILENO);
+    close(devNull);
+
+    double buffered = timePrint(ast.root(), false, repetitions);
+    double unbuffered = timePrint(ast.root(), true, repetitions);
+
+    cerr << "Lines: " << lines << endl;
+    cerr << "Buffered (ms): " << buffered << "\tns/line: " << buffered * 1e6 / lines << endl;
+    cerr << "Unbuffered (ms): " << unbuffered << "\tns/line: " << unbuffered * 1e6 / lines << endl;
+    cerr << "Speedup: " << unbuffered / buffered << "x" << endl;
+    return 0;
+}
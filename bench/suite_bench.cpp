@@ -0,0 +1,305 @@
+//BENCHMARK SUITE
+//Times every phase (lexer, parser, resolver and optimizer passes, bytecode compiler, tree walker, virtual machine) on
+//the tests/in*.py fixtures and on generated workloads scaled to a number of lines:
+//  nested       functions of if/else statements nested 12 levels deep, like GetVal() in tests/in14.py
+//  assignments  a long straight-line chain of assignments that read the previous variable
+//  lists        large list literals and list indexing
+//  functions    many small function definitions, each called once
+//Every phase is repeated in batches of at least 1 ms, the median, minimum and spread of the batches are reported with
+//throughput in source lines/s and statements/s (statements written in the source, not executed ones).
+//Each workload runs in a child process, so a fixture that ends with an ERROR only loses the phases after the error.
+//Printed output goes to /dev/null, results are reported on stderr.
+//  g++ -O2 bench/suite_bench.cpp -o suite_bench && ./suite_bench [--scale=lines] [--repetitions=n] [files.py...]
+//  ./suite_bench --generate=dir [--scale=lines]    writes the generated workloads to dir instead of timing them
+#define MINIPYTHON_NO_MAIN
+#include "../minipython.cpp"
+
+#include <cmath>
+#include <sys/wait.h>
+
+//Timing of one phase over all repetitions, in ms per run
+struct Timing {
+    double median = 0;
+    double best = 0;
+    double spread = 0; //(slowest - fastest) / median
+};
+
+struct Workload {
+    string name;
+    string source;
+};
+
+//Runs body() in batches long enough for the clock, setup(batch) prepares the inputs of a batch outside the timing
+template <typename Setup, typename Body>
+Timing measure(int repetitions, Setup setup, Body body) {
+    const double minimumBatch = 1; //ms
+
+    //Calibrate the batch size with one run
+    setup(1);
+    auto start = chrono::steady_clock::now();
+    body(0);
+    double once = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    int batch = once >= minimumBatch ? 1 : (int)min(100000.0, ceil(minimumBatch / max(once, 1e-6)));
+
+    vector<double> samples;
+    for (int r = 0; r < repetitions; r++) {
+        setup(batch);
+        start = chrono::steady_clock::now();
+        for (int i = 0; i < batch; i++) body(i);
+        samples.push_back(chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() / batch);
+    }
+    sort(samples.begin(), samples.end());
+
+    Timing timing;
+    timing.median = samples[samples.size() / 2];
+    timing.best = samples.front();
+    timing.spread = (samples.back() - samples.front()) / timing.median;
+    return timing;
+}
+
+template <typename Body>
+Timing measure(int repetitions, Body body) {
+    return measure(repetitions, [](int) {}, body);
+}
+
+//Statements written in the source: children of the program, of function definitions and of if/else blocks
+int countStatements(const ASTNode& node) {
+    int statements = 0;
+    for (const ASTNode& child : node.children()) statements += 1 + countStatements(child);
+    for (const ASTNode& expression : node.expression()) statements += countStatements(expression); //else blocks
+    return statements;
+}
+
+//Sends one line of results to the parent process
+void report(int pipe, const string& line) {
+    string text = line + "\n";
+    if (write(pipe, text.data(), text.size()) < 0) exit(1);
+}
+
+void report(int pipe, const char* phase, const Timing& timing) {
+    ostringstream line;
+    line << phase << " " << timing.median << " " << timing.best << " " << timing.spread;
+    report(pipe, line.str());
+}
+
+//Child process: runs every phase of one workload, reporting each phase as soon as it is measured.
+//An ERROR in the script exits the child in the middle of a phase
+void runWorkload(const Workload& workload, int repetitions, int pipe) {
+    const string& source = workload.source;
+
+    report(pipe, "lexer", measure(repetitions, [&](int) { TokenStream t = lexer(source); }));
+    TokenStream tokens = lexer(source);
+    report(pipe, "parser", measure(repetitions, [&](int) { AST a = parseTree(tokens); }));
+    AST parsed = parseTree(tokens);
+    report(pipe, "statements " + to_string(countStatements(parsed.root())));
+
+    //Resolver and optimizer rewrite the AST, every run gets its own parsed tree (ASTs cannot be copied)
+    vector<AST> copies;
+    auto copy = [&](int batch) {
+        copies.clear();
+        for (int i = 0; i < batch; i++) copies.push_back(parseTree(tokens));
+    };
+    report(pipe, "passes", measure(repetitions, copy, [&](int i) {
+        resolve(copies[i].root());
+        optimize(copies[i], copies[i].root());
+    }));
+    copies.clear();
+
+    AST ast = prepare(source);
+    report(pipe, "compile", measure(repetitions, [&](int) { Bytecode b = compile(ast.root()); }));
+    Bytecode bytecode = compile(ast.root());
+
+    report(pipe, "tree", measure(repetitions, [&](int) {
+        environment.reset();
+        interpret(ast.root());
+        output.flush();
+    }));
+    report(pipe, "vm", measure(repetitions, [&](int) {
+        environment.reset();
+        run(bytecode);
+        output.flush();
+    }));
+}
+
+//Prints the results of one workload, the first phase missing from the child output was stopped by an error
+void printWorkload(const Workload& workload, const string& results, int status) {
+    const string& source = workload.source;
+    int lines = count(source.begin(), source.end(), '\n') + (!source.empty() && source.back() != '\n');
+    int statements = 0;
+
+    istringstream input(results);
+    string phase;
+    map<string, Timing> timings;
+    while (input >> phase) {
+        if (phase == "statements") {
+            input >> statements;
+            continue;
+        }
+        Timing& timing = timings[phase];
+        input >> timing.median >> timing.best >> timing.spread;
+    }
+
+    cerr << workload.name << ": " << lines << " lines, " << statements << " statements" << endl;
+    cerr << "  " << left << setw(10) << "Phase" << setw(14) << "Median (us)" << setw(12) << "Min (us)" << setw(10) << "Spread"
+         << setw(14) << "Lines/s" << "Statements/s" << endl;
+    cerr << fixed;
+
+    const char* const phases[] = {"lexer", "parser", "passes", "compile", "tree", "vm"};
+    double pipeline = 0; //lexer, parser, passes and tree walker: the default way a script is run
+    for (const char* phase : phases) {
+        auto found = timings.find(phase);
+        if (found == timings.end()) {
+            cerr << "  " << setw(10) << phase << "stopped by an error (exit status " << WEXITSTATUS(status) << ")" << endl;
+            return;
+        }
+        const Timing& timing = found->second;
+        if (string(phase) != "compile" && string(phase) != "vm") pipeline += timing.median;
+        ostringstream spread;
+        spread << fixed << setprecision(1) << timing.spread * 100 << "%";
+        cerr << "  " << setw(10) << phase << setprecision(1) << setw(14) << timing.median * 1000 << setw(12) << timing.best * 1000
+             << setw(10) << spread.str() << setprecision(0) << setw(14) << lines * 1000.0 / timing.median
+             << statements * 1000.0 / timing.median << endl;
+    }
+    cerr << "  " << setw(10) << "pipeline" << setprecision(1) << setw(14) << pipeline * 1000 << setw(22) << ""
+         << setprecision(0) << setw(14) << lines * 1000.0 / pipeline << statements * 1000.0 / pipeline << endl;
+}
+
+//GENERATED WORKLOADS
+
+//One if/else level per depth, the condition holds so the innermost level runs
+void generateIf(string& script, int level, int depth, const string& indent) {
+    if (level == depth) return;
+    script += indent + "if i > " + to_string(level) + ":\n";
+    script += indent + "    val = val + " + to_string(level) + "\n";
+    generateIf(script, level + 1, depth, indent + "    ");
+    script += indent + "else:\n";
+    script += indent + "    val = val + 1\n";
+}
+
+string generateNested(int lines) {
+    const int depth = 12;
+    const int functionLines = 4 * depth + 5;
+    string script;
+    for (int k = 0; k == 0 || k * functionLines < lines; k++) {
+        string function = "nested" + to_string(k);
+        script += "def " + function + "(i):\n    val = 0\n";
+        generateIf(script, 0, depth, "    ");
+        script += "    return val\n\n";
+        script += "r = " + function + "(" + to_string(depth) + ")\n";
+    }
+    return script;
+}
+
+string generateAssignments(int lines) {
+    const int variables = 512;
+    string script;
+    for (int k = 0; k < variables; k++) script += "v" + to_string(k) + " = " + to_string(k) + "\n";
+    for (int k = variables; k < lines; k++) {
+        script += "v" + to_string(k % variables) + " = v" + to_string((k - 1) % variables) + " + " + to_string(k % 10) + "\n";
+    }
+    return script;
+}
+
+string generateLists(int lines) {
+    const int elements = 100;
+    const int variables = 64; //Reused so memory does not grow with the scale
+    string script = "s = 0\n";
+    for (int k = 1; k < lines; k++) {
+        string name = "l" + to_string(k % variables);
+        if (k % 4 == 0) {
+            //The list assigned on the previous line
+            script += "s = s + l" + to_string((k - 1) % variables) + "[" + to_string(k % elements) + "]\n";
+            continue;
+        }
+        script += name + " = [";
+        for (int e = 0; e < elements; e++) script += (e > 0 ? ", " : "") + to_string(k + e);
+        script += "]\n";
+    }
+    return script;
+}
+
+string generateFunctions(int lines) {
+    string script = "x = 0\n";
+    for (int k = 0; 1 + k * 5 < lines; k++) {
+        string function = "f" + to_string(k);
+        script += "def " + function + "(a, b):\n    c = a + b\n    return c\n\n";
+        script += "x = " + function + "(x, " + to_string(k % 100) + ")\n";
+    }
+    return script;
+}
+
+vector<Workload> generateWorkloads(int lines) {
+    return {
+        {"nested", generateNested(lines)},
+        {"assignments", generateAssignments(lines)},
+        {"lists", generateLists(lines)},
+        {"functions", generateFunctions(lines)},
+    };
+}
+
+int main(int argc, char* argv[]) {
+    int scale = 50000;
+    int repetitions = 7;
+    string generateDirectory;
+    vector<string> files;
+    for (int i = 1; i < argc; i++) {
+        string argument = argv[i];
+        if (argument.rfind("--scale=", 0) == 0) scale = stoi(argument.substr(8));
+        else if (argument.rfind("--repetitions=", 0) == 0) repetitions = max(1, stoi(argument.substr(14)));
+        else if (argument.rfind("--generate=", 0) == 0) generateDirectory = argument.substr(11);
+        else files.push_back(argument);
+    }
+
+    vector<Workload> generated = generateWorkloads(scale);
+    if (!generateDirectory.empty()) {
+        filesystem::create_directories(generateDirectory);
+        for (const Workload& workload : generated) {
+            string path = generateDirectory + "/" + workload.name + ".py";
+            ofstream(path) << workload.source;
+            cerr << "Wrote " << path << endl;
+        }
+        return 0;
+    }
+
+    //Fixtures from tests/ (run from the repository root) unless scripts are given
+    if (files.empty()) {
+        for (const auto& entry : filesystem::directory_iterator("tests")) {
+            if (entry.path().extension() == ".py") files.push_back(entry.path().string());
+        }
+        sort(files.begin(), files.end());
+    }
+    vector<Workload> workloads;
+    for (const string& file : files) workloads.push_back({file, getInput(file)});
+    for (Workload& workload : generated) workloads.push_back(move(workload));
+
+    //Send printed lines to /dev/null so the terminal does not dominate the measurement
+    int devNull = open("/dev/null", O_WRONLY);
+    dup2(devNull, STDOUT_FILENO);
+    close(devNull);
+
+    for (const Workload& workload : workloads) {
+        int channel[2];
+        if (pipe(channel) != 0) return 1;
+        pid_t child = fork();
+        if (child == 0) {
+            close(channel[0]);
+            try {
+                runWorkload(workload, repetitions, channel[1]);
+            } catch (const ScriptError&) {
+                exit(1);
+            }
+            exit(0);
+        }
+        close(channel[1]);
+
+        string results;
+        char buffer[4096];
+        ssize_t size;
+        while ((size = read(channel[0], buffer, sizeof(buffer))) > 0) results.append(buffer, size);
+        close(channel[0]);
+        int status = 0;
+        waitpid(child, &status, 0);
+        printWorkload(workload, results, status);
+    }
+    return 0;
+}
@@ -0,0 +1,51 @@
+//ENGINE BENCHMARK
+//Runs an arithmetic heavy script and a call heavy script with the tree walker and with the bytecode virtual machine.
+//  g++ -O2 bench/vm_bench.cpp -o vm_bench && ./vm_bench
+#define MINIPYTHON_NO_MAIN
+#include "../minipython.cpp"
+
+#include <chrono>
+
+//Returns the time in ms of the fastest run of a script with the selected engine
+double timeEngine(const string& script, bool vm, int repetitions) {
+    AST ast = prepare(script);
+    Bytecode bytecode = compile(ast.root());
+
+    double best = 0;
+    for (int i = 0; i < repetitions; i++) {
+        environment.reset();
+        auto start = chrono::steady_clock::now();
+        if (vm) {
+            run(bytecode);
+        } else {
+            interpret(ast.root());
+        }
+        double elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        if (i == 0 || elapsed < best) best = elapsed;
+    }
+    return best;
+}
+
+int main() {
+    const int statements = 90000;
+    const int repetitions = 5;
+
+    string arithmetic = "x = 0\ny = 1\n";
+    for (int i = 0; i < statements / 3; i++) {
+        arithmetic += "x = x + 1\n";
+        arithmetic += "y = x + x + 3\n";
+        arithmetic += "if x >= y:\n    y = y + 1\n";
+    }
+
+    string calls = "def increment(val):\n    val = val + 1\n    return val\n\ni = 0\n";
+    for (int i = 0; i < statements; i++) calls += "i = increment(i)\n";
+
+    const pair<string, const string*> scripts[] = {{"arithmetic", &arithmetic}, {"calls", &calls}};
+    cout << "Script\t\tTree (ms)\tVM (ms)\t\tSpeedup" << endl;
+    for (const auto& script : scripts) {
+        double tree = timeEngine(*script.second, false, repetitions);
+        double vm = timeEngine(*script.second, true, repetitions);
+        cout << script.first << "\t" << tree << "\t\t" << vm << "\t\t" << tree / vm << "x" << endl;
+    }
+    return 0;
+}
@@ -6,7 +6,28 @@
 #include <sstream>
 #include <algorithm>
 #include <unordered_map>
+#include <deque>
+#include <string_view>
 #include <filesystem>
+#include <charconv>
+#include <iomanip>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <sys/resource.h>
+#include <cstring>
+#include <climits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "minipython.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MINIPYTHON_X86 //SSE2 and AVX2 scanning, chosen at runtime
+#endif
 
 using namespace std;
 
@@ -14,1362 +35,3463 @@ using namespace std;
 const bool DEBUG = false;
 
 // TOKENIZER TYPE CONSTANTS
-const string NEW_LINE = "NEW_LINE";
-const string INDENT = "INDENT";
-const string EQUALS = "EQUAL";
-const string COLON = "COLON";
-const string SEMICOLON = "SEMICOLON";
-const string COMMA = "COMMA";
-const string SPACE = "SPACE";
-
-const string PLUS = "PLUS";
-
-const string OPERATOR = "OPERATOR";
-
-const string OPEN_PARENTHESES = "OPEN_PARENTHESES";
-const string CLOSE_PARENTHESES = "CLOSE_PARENTHESES";
-const string OPEN_BRACKET = "OPEN_BRACKET";
-const string CLOSE_BRACKET = "CLOSE_BRACKET";
-const string OPEN_BRACE = "OPEN_BRACE";
-const string CLOSE_BRACE = "CLOSE_BRACE";
-
-const string NUMBER = "NUMBER";
-const string TRUE = "TRUE";
-const string FALSE = "FALSE";
-const string NULL_IDENTIFIER = "NULL";
-const string IDENTIFIER = "IDENTIFIER";
-const string STRING = "STRING";
-
-const string PRINT = "PRINT";
-const string IF = "IF";
-const string ELSE = "ELSE";
-const string LENGTH = "LENGTH";
-
-const string FUNCTION_DEFINITION = "FUNCTION_DEFINITION";
-const string RETURN = "RETURN";
-
-const string BLOCK_START = "BLOCK_START";
-const string BLOCK_END = "BLOCK_END";
-
-const string COMMENT = "COMMENT";
-
-//Each Token represents a word, a symbol or a number
-struct token {
-    string type;
-    string value = "";
-    int line;
-    int position;
-};
+enum TokenType : unsigned char {
+    NEW_LINE,
+    EQUALS,
+    COLON,
+    COMMA,
 
-//AST Node Types
-const string AST_PROGRAM = "PROGRAM";
-const string AST_ASSIGMENT = "ASSIGMENT";
-const string AST_OPERATION = "OPERATION";
-const string AST_NUMBER = "NUMBER";
-const string AST_STRING = "STRING";
-const string AST_BOOLEAN = "BOOLEAN";
-const string AST_NULL = "NULL";
-const string AST_LIST = "LIST";
-const string AST_LIST_INDEX = "LIST_INDEX";
-const string AST_IDENTIFIER = "IDENTIFIER";
-const string AST_FUNCTION_CALL = "FUNCTION_CALL";
-const string AST_EXPRESSION = "EXPRESSION";
-const string AST_BODY = "BODY";
-const string AST_FUNCTION = "FUNCTION";
-const string AST_PARAMETER = "PARAMETER";
-const string AST_RETURN = "RETURN";
-const string AST_ERROR = "ERROR";
-const string AST_LENGTH = "LENGTH";
-
-int linesToSkip = 0; //Used with function definitions, if and else statements so that those lines are nor parsed several times
+    PLUS,
 
-//Each AST node can have children like the program root node or functions. Paarameters like conditions on if statements and arguments in functions. And Expressions which involves assigments. operations, function calls and so on.
-class ASTNode {
-    public:
-        string type;
-        string value;
-        string symbol;
-        vector<ASTNode> children;
-        vector<ASTNode> parameters;
-        vector<ASTNode> expression;
-        int line;
-};
+    OPERATOR,
 
-//Interpreter Variables functions and types. Used for evaluation of the AST
-class Symbol{
-    public:
-        string type;
-        int integer;
-        string str;
-        bool boolean;
-        vector<int> list;
-        ASTNode function;
-        int line;
-};
+    OPEN_PARENTHESES,
+    CLOSE_PARENTHESES,
+    OPEN_BRACKET,
+    CLOSE_BRACKET,
 
-unordered_map<string, Symbol> variables; //Stores all variables from the outer scope
+    NUMBER,
+    TRUE,
+    FALSE,
+    NULL_IDENTIFIER,
+    IDENTIFIER,
+    STRING,
 
-//Function Declarations
-string getInput(string input);
-vector<vector<token>> lexer(string input);
-token makeOneSymbolToken(string type, string value, int line, int position);
-ASTNode parseTree(vector<vector<token>> tokens);
-ASTNode parseStatement(vector<vector<token>> tokens, int line, int tokenIndex, token lookahead);
-void printASTTree(ASTNode node, int tabs); //DEBUGGING
-void interpret(ASTNode ASTRoot);
-Symbol traverse(ASTNode node);
+    PRINT,
+    IF,
+    ELSE,
+    LENGTH,
 
-int main(int argc, char* argv[]) {
-    //Obtain input from file string
-    string pythonFile = getInput(argv[1]);
+    FUNCTION_DEFINITION,
+    RETURN,
 
-    //Lexer
-    vector<vector<token>> tokens = lexer(pythonFile);
+    BLOCK_START,
+    BLOCK_END,
 
-    //Parser
-    ASTNode ast = parseTree(tokens);
+    END_OF_FILE
+};
 
-    if (DEBUG) {
-        cout << "\n" << "****************AST TREE****************" << endl;
-        //Print AST Tree
-        printASTTree(ast, 0);
-    }
+//Token type names, used for debugging and error messages
+const char* const TOKEN_NAMES[] = {
+    "NEW_LINE", "EQUAL", "COLON", "COMMA", "PLUS", "OPERATOR",
+    "OPEN_PARENTHESES", "CLOSE_PARENTHESES", "OPEN_BRACKET", "CLOSE_BRACKET",
+    "NUMBER", "TRUE", "FALSE", "NULL", "IDENTIFIER", "STRING",
+    "PRINT", "IF", "ELSE", "LENGTH", "FUNCTION_DEFINITION", "RETURN",
+    "BLOCK_START", "BLOCK_END", "END_OF_FILE"
+};
 
-    //Interpreter
-    interpret(ast);
-    
-    return 0;
-}
+//Lexer character classes. A byte can be in several classes, each class is one bit
+const unsigned char CHAR_SPACE = 1; //Indentation and separator between tokens
+const unsigned char CHAR_DIGIT = 2;
+const unsigned char CHAR_LETTER = 4; //First character of an identifier
+const unsigned char CHAR_IDENTIFIER = 8; //Rest of an identifier: letters, digits and _
+
+//Class of every byte value, so the lexer tests a character with one table lookup
+struct CharacterTable {
+    unsigned char classes[256];
+
+    constexpr CharacterTable() : classes() {
+        classes[(unsigned char)' '] = CHAR_SPACE;
+        for (int c = '0'; c <= '9'; c++) classes[c] = CHAR_DIGIT | CHAR_IDENTIFIER;
+        for (int c = 'a'; c <= 'z'; c++) classes[c] = CHAR_LETTER | CHAR_IDENTIFIER;
+        for (int c = 'A'; c <= 'Z'; c++) classes[c] = CHAR_LETTER | CHAR_IDENTIFIER;
+        classes[(unsigned char)'_'] = CHAR_IDENTIFIER;
+    }
 
-//INPUT FUNCTION
-string getInput(string input) {
-    //Obtains a string from the input python file
-    ifstream inputFile(input);
-    if (!inputFile.is_open()) {
-        cout << "No parameters were passed" << endl;
-        exit(1);
+    bool is(char c, unsigned char characterClass) const {
+        return classes[(unsigned char)c] & characterClass;
     }
-    return string((istreambuf_iterator<char>(inputFile)), istreambuf_iterator<char>());
-}
+};
 
-//LEXER (TOKENIZER)
-vector<vector<token>> lexer(string input) {
-    if (DEBUG) cout << "****************LEXER****************" << endl;
-    vector<vector<token>> tokens; //2D vector of tokens where each vector represents a line
-    vector<token> lineTokens; //Vector of tokens for each line
-    int line = 1; //Stores line of code in input file
-    int position = 1; //Stores character position in line
-    int currIndex = 0; //Stores current index of input string (Entire file)
-    int indentationLevel = 0; //Stores indentation level of current line depending on if statements and function definitions
-    int indentationLength = 0; //Stores length of indentation of current line (number of spaces used for indentation)
-    bool isIndent = false; //Boolean to help check for indentation when switching to new lines
-    int lastIndentationLength = 0; //Stores length of indentation of previous line (number of spaces used for indentation)
-
-    while (currIndex < input.length()) {
-        string lookahead = ""; //Stores lookahead character
-        lookahead += input[currIndex]; //Adds current character to lookahead
-
-        //NEW LINE
-        if (lookahead == "\n") {
-            if(isIndent) {
-                //Check for proper indentation on the next line
-                    //Obtain length of indentation
-                string indentation = "";
-
-                //If indentation level is 1 and the indentation length is 0 (no spaces). Obtain indentation length since this is the first indented line
-                if (indentationLevel == 1 && indentationLength == 0) {
-                    int index = 1;
-                    while (input[currIndex+index] == ' ') {
-                        index ++;
-                        indentationLength ++;
-                    }
-                }
+constexpr CharacterTable CHARACTERS;
 
-                //Get indentation length of next line
-                for (int i = 1; i <= indentationLength * indentationLevel; i++) {
-                    if (input[currIndex+i] == ' ') {
-                        indentation += input[currIndex+i];
-                    } else {
-                        break;
-                    }
-                }
-                    //Check indentation length corresponds to the current indentation level
-                if (indentation.length() != 0 && indentation.length() % (indentationLength*indentationLevel) == 0) {
-                    currIndex += 1 + indentation.length();
-                    position += 1 + indentation.length();
-                    line ++;
-                    if (lineTokens.size() > 0) tokens.push_back(lineTokens);
-                    lineTokens.clear();
-                    continue;
-                }
-                //If there is directly a next line ignore but increase line counter
-                if (input[currIndex+1] == '\n') {
-                    currIndex ++;
-                    position ++;
-                    line ++;
-                    continue;
-                }
-                //if indentation is 0 and the indentation level is greater than one. This means that several levels of indentation ended so add corresponding breaking points.
-                if (indentation.length() == 0 && indentationLevel > 1) {
-                    for (int i = 1; i < indentationLevel; i++) {
-                        vector<token> breakLine;
-                        breakLine.push_back(makeOneSymbolToken(BLOCK_END, BLOCK_END, line, position));
-                        tokens.push_back(breakLine);
-                        indentationLevel --;
-                    }
-                }
-                
-                indentationLevel --; //Decrease indentation level
-                if (indentationLevel == 0) isIndent = false; //If indentation level is 0 then there is no indentation
-                lineTokens.push_back(makeOneSymbolToken(BLOCK_END, "BLOCK_END", line, position)); //Add BLOCK_END token to line
-                indentationLength = indentationLength * indentationLevel; //Update indentation length
-                line ++; //Increase line counter
-                currIndex += 1 + indentation.length(); //Increase current index
-                position += 1 + indentation.length(); //Increase position counter
-                tokens.push_back(lineTokens); //Add line tokens to tokens vector
-                lineTokens.clear(); //Clear line tokens vector
-                continue;
-            }
+//Each Token represents a word, a symbol or a number. Tokens do not own their text, they point into the input buffer
+//Packed in 16 bytes: the token array of a large script is the biggest allocation of the lexer
+struct token {
+    int offset; //Index of the first character in the input buffer. Position in file is offset + 1
+    int length; //Number of characters in the input buffer. Strings include their quotes
+    int symbol = -1; //Interned identifier index for IDENTIFIER tokens
+    unsigned line : 24;
+    TokenType type : 8;
+};
 
-            //if there is no indentation proceed as normal
-            currIndex ++; 
-            position ++;
-            line ++;
-            if (lineTokens.size()>0) {
-                tokens.push_back(lineTokens);
-                lineTokens.clear();
+static_assert(sizeof(token) == 16, "token has to stay packed");
+const int MAX_LINES = (1 << 24) - 1; //Largest line number a token can store
+
+//Interned identifier table. Every distinct identifier in the input is stored once and referenced by index
+//Open addressing with linear probing: a lookup hashes the name once and usually compares a single entry
+struct IdentifierTable {
+    vector<string_view> names; //Views into the input buffer
+    vector<int> buckets = vector<int>(64, -1); //Index in names of every used bucket, -1 if empty. Size is a power of two
+
+    int intern(string_view name) {
+        size_t mask = buckets.size() - 1;
+        for (size_t bucket = hash(name) & mask; ; bucket = (bucket + 1) & mask) {
+            int index = buckets[bucket];
+            if (index < 0) {
+                buckets[bucket] = names.size();
+                names.push_back(name);
+                if (names.size() * 2 > buckets.size()) grow();
+                return names.size() - 1;
             }
-            continue;
+            if (names[index] == name) return index;
         }
+    }
 
-        //COMMENT
-        if(lookahead == "#") {
-            position ++;
-            currIndex ++;
-            lookahead = input[currIndex];
-            while (lookahead != "\n" && currIndex <= input.length()) {
-                position ++;
-                currIndex ++;
-                lookahead = input[currIndex];
-            }
-            continue;
-        }
+    //FNV-1a, identifiers are short so a byte at a time is enough
+    static size_t hash(string_view name) {
+        uint32_t value = 2166136261u;
+        for (char c : name) value = (value ^ (unsigned char)c) * 16777619u;
+        return value;
+    }
 
-        //SPACE
-        if (lookahead == " ") {
-            position ++;
-            currIndex ++;
-            continue;
-            
+    //Doubles the bucket array and inserts every name again
+    void grow() {
+        buckets.assign(buckets.size() * 2, -1);
+        size_t mask = buckets.size() - 1;
+        for (int index = 0; index < (int)names.size(); index++) {
+            size_t bucket = hash(names[index]) & mask;
+            while (buckets[bucket] >= 0) bucket = (bucket + 1) & mask;
+            buckets[bucket] = index;
         }
+    }
+};
 
-        //SEMICOLON
-        if (lookahead == ";") {
-            //ignore space
-            position ++;
-            currIndex ++;
-            continue;
-        }
+//Output of the lexer. The input buffer has to outlive the stream since tokens and identifiers point into it
+struct TokenStream {
+    string_view source;
+    vector<token> tokens;
+    IdentifierTable identifiers;
+};
 
-        //COMMA
-        if(lookahead == ",") {
-            lineTokens.push_back(makeOneSymbolToken(COMMA, lookahead, line, position));
-            position ++;
-            currIndex ++;
-            continue;
-        }
+class ASTNode; //Function values point to their definition
+
+//Interpreter value types
+enum ValueType : unsigned char {
+    VALUE_NONE, //Result of statements and of functions without a return
+    VALUE_NUMBER,
+    VALUE_STRING,
+    VALUE_BOOLEAN,
+    VALUE_NULL,
+    VALUE_LIST,
+    VALUE_FUNCTION,
+    VALUE_UNDEFINED //Slot of a variable that has not been assigned yet
+};
 
-        //COLON 
-        if(lookahead == ":") {
-            lineTokens.push_back(makeOneSymbolToken(COLON, lookahead, line, position));
-            position ++;
-            currIndex ++;
-            continue;
-        }
+//Value type names, used for error messages
+const char* const VALUE_NAMES[] = {"", "NUMBER", "STRING", "BOOLEAN", "NULL", "LIST", "function", "undefined"};
 
-        //EQUALS, and IS EQUAL operators
-        if (lookahead == "=") {
-            currIndex ++;
-            lookahead = input[currIndex];
-            if (lookahead == "=") {
-                lineTokens.push_back(makeOneSymbolToken(OPERATOR, "==", line, position));
-                position += 2;
-                currIndex ++;
-                continue;
-            } else {
-                lineTokens.push_back(makeOneSymbolToken(EQUALS, "=", line, position));
-                position ++;
-                continue;
-            }
-        }
+//Heap payload of strings and lists. Shared by reference counting between values, freed when the last value goes away
+struct HeapObject {
+    int references = 0;
+    virtual ~HeapObject() {}
+};
 
-        //GREATER and GREATER THAN operators
-        if (lookahead == ">") {
-            currIndex ++;
-            lookahead = input[currIndex];
-            if (lookahead == "=") {
-                lineTokens.push_back(makeOneSymbolToken(OPERATOR, ">=", line, position));
-                position += 2;
-                currIndex ++;
-                continue;
-            } else {
-                lineTokens.push_back(makeOneSymbolToken(OPERATOR, ">", line, position));
-                position ++;
-                continue;
-            }
-        }
+struct StringObject : HeapObject {
+    string str;
+};
 
-        //LESS and LESS THAN operators
-        if (lookahead == "<") {
-            currIndex ++;
-            lookahead = input[currIndex];
-            if (lookahead == "=") {
-                lineTokens.push_back(makeOneSymbolToken(OPERATOR, "<=", line, position));
-                position += 2;
-                currIndex ++;
-                continue;
-            } else {
-                lineTokens.push_back(makeOneSymbolToken(OPERATOR, "<", line, position));
-                position ++;
-                continue;
-            }
-        }
+//Lists are one allocation: the header followed by the elements, so copying or concatenating them is a single memcpy.
+//Values share a list until one of them writes to it (copy on write)
+struct ListObject : HeapObject {
+    int size = 0;
+
+    int* begin() { return reinterpret_cast<int*>(this + 1); }
+    int* end() { return begin() + size; }
+    const int* begin() const { return reinterpret_cast<const int*>(this + 1); }
+    const int* end() const { return begin() + size; }
+    int& operator[](int index) { return begin()[index]; }
+
+    //Allocates a list of size elements, the elements are not initialized
+    static ListObject* create(int size) {
+        ListObject* list = new (::operator new(sizeof(ListObject) + size * sizeof(int))) ListObject();
+        list->size = size;
+        return list;
+    }
 
-        //NOT_EQUAL operator
-        if (lookahead == "!") {
-            currIndex ++;
-            lookahead = input[currIndex];
-            if (lookahead == "=") {
-                lineTokens.push_back(makeOneSymbolToken(OPERATOR, "!=", line, position));
-                position += 2;
-                currIndex ++;
-                continue;
-            } else {
-                cout << "ERROR: Invalid symbol " << lookahead << " at line " << line << " position " << position << endl;
-                exit(1);
+    //Matches create(), the allocation is larger than sizeof(ListObject)
+    static void operator delete(void* memory) {
+        ::operator delete(memory);
+    }
+};
+
+//Interpreter Variables functions and types. Used for evaluation of the AST
+//A tagged union: numbers, booleans and functions are stored inline, strings and lists behind a reference counted pointer
+class Value {
+    public:
+        ValueType type = VALUE_NONE;
+        union {
+            int integer;
+            bool boolean;
+            HeapObject* object;
+            const ASTNode* function; //Function definition node, owned by the AST
+        };
+
+        Value() : object(nullptr) {}
+        Value(const Value& other) : type(other.type), object(other.object) { retain(); }
+        Value(Value&& other) noexcept : type(other.type), object(other.object) { other.type = VALUE_NONE; }
+        ~Value() { release(); }
+
+        Value& operator=(const Value& other) {
+            if (this != &other) {
+                Value copy(other);
+                swap(copy);
             }
+            return *this;
         }
 
-        //PLUS
-        if (lookahead == "+") {
-            lineTokens.push_back(makeOneSymbolToken(PLUS, "+", line, position));
-            position ++;
-            currIndex ++;
-            continue;
+        Value& operator=(Value&& other) noexcept {
+            swap(other);
+            return *this;
         }
 
-        //PARENTHESIS
-        if (lookahead == "(") {
-            lineTokens.push_back(makeOneSymbolToken(OPEN_PARENTHESES, "(", line, position));
-            position ++;
-            currIndex ++;
-            continue;
-        }
+        const string& str() const { return static_cast<StringObject*>(object)->str; }
+        ListObject& list() const { return *static_cast<ListObject*>(object); }
 
-        if (lookahead == ")") {
-            lineTokens.push_back(makeOneSymbolToken(CLOSE_PARENTHESES, ")", line, position));
-            position ++;
-            currIndex ++;
-            continue;
-        }
+    private:
+        bool isHeap() const { return type == VALUE_STRING || type == VALUE_LIST; }
 
-        //BRACKETS
-        if (lookahead == "[") {
-            lineTokens.push_back(makeOneSymbolToken(OPEN_BRACKET, "[", line, position));
-            position ++;
-            currIndex ++;
-            continue;
+        void retain() {
+            if (isHeap()) object->references ++;
         }
 
-        if (lookahead == "]") {
-            lineTokens.push_back(makeOneSymbolToken(CLOSE_BRACKET, "]", line, position));
-            position ++;
-            currIndex ++;
-            continue;
+        void release() {
+            if (isHeap() && --object->references == 0) delete object;
         }
 
-        //STRING
-        if (lookahead == "\"") {
-            string str = "";
-            currIndex ++;
-            lookahead = input[currIndex];
-            while (lookahead != "\"") {
-                str += lookahead;
-                currIndex ++;
-                lookahead = input[currIndex];
-            }
-            lineTokens.push_back(makeOneSymbolToken(STRING, str, line, position));
-            position += str.length() + 2;
-            currIndex ++;
-            continue;
+        void swap(Value& other) {
+            std::swap(type, other.type);
+            std::swap(object, other.object);
         }
+};
 
-        //INTEGER
-        if (isdigit(lookahead[0])) {
-            //obtain integer
-            string number = "";
-            while (isdigit(input[currIndex]) && currIndex < input.length()) {
-                number += input[currIndex];
-                currIndex ++;
-            }
+static_assert(sizeof(Value) <= 16, "Value has to stay a small tagged union");
 
-            //create integer token
-            lineTokens.push_back(makeOneSymbolToken(NUMBER, number, line, position));
-            position += number.length();
-            continue;
-        }
+//AST Node Types
+enum NodeType : unsigned char {
+    AST_PROGRAM,
+    AST_ASSIGMENT,
+    AST_OPERATION,
+    AST_NUMBER,
+    AST_STRING,
+    AST_BOOLEAN,
+    AST_NULL,
+    AST_LIST,
+    AST_LIST_INDEX,
+    AST_IDENTIFIER,
+    AST_FUNCTION_CALL, //User function call, arguments in parameters
+    AST_BUILTIN, //print() or len(), the argument in expression
+    AST_IF, //Condition in parameters, then branch in children, else branch in expression
+    AST_BLOCK, //Block that always runs: an if statement whose condition the optimizer found constant
+    AST_EXPRESSION,
+    AST_FUNCTION,
+    AST_PARAMETER,
+    AST_RETURN
+};
 
-        //IDENTIFIER
-        if (isalpha(lookahead[0])) {
-            //obtain identifier
-            string identifier = "";
-            while ((isalpha(input[currIndex]) || isdigit(input[currIndex]) || input[currIndex] == '_') && currIndex < input.length()) {
-                identifier += input[currIndex];
-                currIndex ++;
-            }
+//AST node type names, used for debugging
+const char* const AST_NAMES[] = {
+    "PROGRAM", "ASSIGMENT", "OPERATION", "NUMBER", "STRING", "BOOLEAN", "NULL", "LIST", "LIST_INDEX",
+    "IDENTIFIER", "FUNCTION_CALL", "BUILTIN", "IF", "BLOCK", "EXPRESSION", "FUNCTION", "PARAMETER", "RETURN"
+};
+const int NODE_TYPES = sizeof(AST_NAMES) / sizeof(AST_NAMES[0]);
+
+//Kind of an operation node, chosen by the optimizer from its operator and literal terms. Integer kinds check that both
+//terms are numbers when they run and compute the result directly, any other terms take the generic path (operate())
+enum OperationKind : unsigned char {
+    OPERATION_GENERIC,
+    OPERATION_ADD_INT,
+    OPERATION_EQUAL_INT,
+    OPERATION_NOT_EQUAL_INT,
+    OPERATION_LESS_INT,
+    OPERATION_LESS_EQUAL_INT,
+    OPERATION_GREATER_INT,
+    OPERATION_GREATER_EQUAL_INT,
+    OPERATION_CONCAT_LIST //+ with a list literal term
+};
 
-            //check if identifier is a keyword
-            if (identifier == "print") {
-                lineTokens.push_back(makeOneSymbolToken(PRINT, "print", line, position));
-            } else if (identifier == "len") { 
-                lineTokens.push_back(makeOneSymbolToken(LENGTH, "len", line, position));
-            } else if (identifier == "if") {
-                isIndent = true;
-                indentationLevel ++;
-                lineTokens.push_back(makeOneSymbolToken(IF, "if", line, position));
-            } else if (identifier == "else") {
-                isIndent = true;
-                indentationLevel ++;
-                lineTokens.push_back(makeOneSymbolToken(ELSE, "else", line, position));
-            } else if (identifier == "def") {
-                indentationLevel ++;
-                isIndent = true;
-                lineTokens.push_back(makeOneSymbolToken(FUNCTION_DEFINITION, "def", line, position));
-            } else if (identifier == "return") {
-                lineTokens.push_back(makeOneSymbolToken(RETURN, "return", line, position));
-            } else if (identifier == "True") {
-                lineTokens.push_back(makeOneSymbolToken(TRUE, "true", line, position));
-            } else if (identifier == "False") {
-                lineTokens.push_back(makeOneSymbolToken(FALSE, "false", line, position));
-            } else if (identifier == "None") {
-                lineTokens.push_back(makeOneSymbolToken(NULL_IDENTIFIER, "None", line, position));
-            } else {
-                lineTokens.push_back(makeOneSymbolToken(IDENTIFIER, identifier, line, position));
-            }
-            position += identifier.length();
-            continue;
-        }
+//Builtin function of a builtin node, set by the parser
+enum Builtin : unsigned char {
+    BUILTIN_PRINT,
+    BUILTIN_LEN,
+    BUILTINS
+};
 
-        //ERROR
-        cout << "Error: Invalid character -> " << lookahead << " <- " << "at line " << line << " position " << position << endl;
-        exit(1);
-    }
+//Range of nodes stored next to each other in the AST arena. offset is relative to the node that owns the list,
+//so the node vector can grow, move or be mapped from a cache file anywhere. While a node is being built offset holds
+//the absolute arena index
+struct NodeList {
+    int offset = 0;
+    int count = 0;
+};
 
-    //add line tokens to tokens
-    if (lineTokens.size() > 0) {
-        tokens.push_back(lineTokens);
-    }
+//View over a NodeList, used to iterate children like a vector
+template <typename Node>
+struct NodeRange {
+    Node* first;
+    int count;
 
-    //If DEBUGGING is on print out table with all tokens
-    if (DEBUG){
-        // tokens
-        int tokensFound = 0;
-        for (int i = 0; i<tokens.size(); i++) {
-            tokensFound += tokens[i].size();
-        }
-        cout << "****************TOKENS****************" << endl;
-        cout << "LINES " << tokens.size() << ". TOKENS: " << tokensFound << " tokens found." << endl;
-        cout << "----------------------------------------------------------------------------" << endl;
-        cout << "Type               \t\tValue              \t\tLine\t\tPosition" << endl;
-        for (int i = 0; i<tokens.size(); i++) {
-            for (int j = 0; j < tokens[i].size(); j++) {
-                string type = tokens[i][j].type + string(19-tokens[i][j].type.length(), ' ');
-                string value = tokens[i][j].value + string(19-tokens[i][j].value.length(), ' ');
-                cout << type << "\t\t" << value << "\t\t" << tokens[i][j].line << "\t\t" << tokens[i][j].position << endl;
-            }
-        }
+    Node* begin() const { return first; }
+    Node* end() const { return first + count; }
+    int size() const { return count; }
+    Node& operator[](int i) const { return first[i]; }
+};
 
-    }
+//Each AST node can have children like the program root node or functions. Paarameters like conditions on if statements and arguments in functions. And Expressions which involves assigments. operations, function calls and so on.
+//Nodes live in an AST arena, children are reached through NodeLists instead of owning vectors.
+//symbol and value are views into the input buffer (or into string literals), which has to outlive the AST
+class ASTNode {
+    public:
+        NodeType type;
+        bool local = false; //True if slot indexes the current call frame instead of the global environment
+        OperationKind operation = OPERATION_GENERIC; //Operations: kind chosen by the optimizer
+        Builtin builtin = BUILTIN_PRINT; //Builtin nodes: function called
+        int line;
+        string_view value;
+        string_view symbol;
+        NodeList childList;
+        NodeList parameterList;
+        NodeList expressionList;
+        int slot = -1; //Slot of the variable named by symbol, bound by the resolver
+        int frameSize = 0; //Function definitions: number of local slots, parameters come first
+        int entry = -1; //Function definitions: bytecode address of the body, set by the compiler
+        int integer = 0; //Number and boolean literals: value decoded by the optimizer
+        union {
+            const Value* constant = nullptr; //List literals of constants: the list, built once by the optimizer
+            mutable const ASTNode* callee; //User function calls: inline cache of the function called last, its arity matched
+        };
+
+        NodeRange<const ASTNode> children() const { return {this + childList.offset, childList.count}; }
+        NodeRange<const ASTNode> parameters() const { return {this + parameterList.offset, parameterList.count}; }
+        NodeRange<const ASTNode> expression() const { return {this + expressionList.offset, expressionList.count}; }
+        NodeRange<ASTNode> children() { return {this + childList.offset, childList.count}; }
+        NodeRange<ASTNode> parameters() { return {this + parameterList.offset, parameterList.count}; }
+        NodeRange<ASTNode> expression() { return {this + expressionList.offset, expressionList.count}; }
+};
 
-    return tokens;
-}
+//AST arena: every node of a program in one contiguous vector, freed in one shot. Children are placed before their
+//parent, and siblings next to each other. The root is the last node. An AST can be moved but not copied: optimized
+//nodes point into its strings and lists, a copy would point into the original
+class AST {
+    public:
+        vector<ASTNode> nodes;
+        deque<string> strings; //Text of literals created by the optimizer, deque keeps node views valid when it grows
+        deque<Value> lists; //Constant list literals built by the optimizer, nodes point to them
+
+        AST() = default;
+        AST(AST&&) = default;
+        AST& operator=(AST&&) = default;
+        AST(const AST&) = delete;
+        AST& operator=(const AST&) = delete;
+
+        //Moves nodes into the arena next to each other and returns their range with an absolute offset
+        NodeList place(vector<ASTNode>& pending, int first) {
+            NodeList list;
+            list.offset = nodes.size();
+            list.count = pending.size() - first;
+            for (int i = first; i < (int)pending.size(); i++) place(pending[i]);
+            pending.resize(first);
+            return list;
+        }
 
-//Helper function to create a token
-token makeOneSymbolToken(string type, string value, int line, int position) {
-    //Helper function to create a token for a single symbol
-    token t;
-    t.type = type;
-    t.value = value;
-    t.line = line;
-    t.position = position;
-    return t;
-}
+        //Moves one node into the arena, its lists become relative to its position
+        int place(const ASTNode& node) {
+            int index = nodes.size();
+            nodes.push_back(node);
+            nodes[index].childList.offset -= index;
+            nodes[index].parameterList.offset -= index;
+            nodes[index].expressionList.offset -= index;
+            return index;
+        }
 
+        ASTNode& root() { return nodes.back(); }
+        const ASTNode& root() const { return nodes.back(); }
+};
 
-//TREE PARSING
-ASTNode parseTree(vector<vector<token>> tokens) {
-    if (DEBUG) cout << "\n" << "****************TREE PARSING****************" << endl;
+//Binary operators
+enum Operator : unsigned char {
+    OPERATOR_ADD,
+    OPERATOR_EQUAL,
+    OPERATOR_GREATER,
+    OPERATOR_LESS,
+    OPERATOR_GREATER_EQUAL,
+    OPERATOR_LESS_EQUAL,
+    OPERATOR_NOT_EQUAL,
+    OPERATOR_UNKNOWN
+};
 
-    //create root node: <program>
-    ASTNode root = ASTNode();
-    root.type = "PROGRAM";
-    
-    int line = 0; //current line
-    int tokenIndex = 0; //current token index
-    
-    token lookahead; //current token
-
-    //Iterate through all children in program
-    while (line < tokens.size()) {
-        lookahead = tokens[line][tokenIndex]; //Get current token
-        ASTNode statement = parseStatement(tokens, line, tokenIndex, lookahead); //Parse token
-        root.children.push_back(statement); //Add statement to root
-        if(DEBUG) cout << endl; //DEBUGGING
-        line = linesToSkip == 0 ? line + 1 : linesToSkip + line; //Update line, if indentation was involved in parsing linesToSkip will avoid parsing lines that were already parsed
-        linesToSkip = 0; //Reset linesToSkip
-        tokenIndex = 0; //Reset tokenIndex
-    }
+//BYTECODE INSTRUCTIONS
+//Expressions push one value on the stack, statements leave the stack as they found it
+enum OpCode : unsigned char {
+    OP_PUSH_CONSTANT, //Pushes constants[operand]
+    OP_PUSH_NONE,
+    OP_LOAD_GLOBAL, //Pushes the global in slot operand
+    OP_LOAD_LOCAL, //Pushes the local in slot operand of the current frame
+    OP_STORE_GLOBAL, //Pops into the global in slot operand
+    OP_STORE_LOCAL, //Pops into the local in slot operand of the current frame
+    OP_MAKE_LIST, //Pops operand elements and pushes a list
+    OP_INDEX, //Pops index and list, pushes the element
+    OP_SET_INDEX_GLOBAL, //Pops value and index, writes the element of the list in global slot operand in place
+    OP_SET_INDEX_LOCAL, //Pops value and index, writes the element of the list in local slot operand in place
+    OP_OPERATION, //Pops two terms and pushes the result of Operator operand
+    OP_ADD_INT, //Integer operations, in OperationKind order. Pop two terms and push the result, terms that are not both
+    OP_EQUAL_INT, //numbers take the generic path of Operator operand
+    OP_NOT_EQUAL_INT,
+    OP_LESS_INT,
+    OP_LESS_EQUAL_INT,
+    OP_GREATER_INT,
+    OP_GREATER_EQUAL_INT,
+    OP_CONCAT_LIST, //Pops two lists and pushes their concatenation, other terms take the generic path of Operator operand
+    OP_JUMP, //Jumps to address operand
+    OP_JUMP_IF_FALSE, //Pops a condition and jumps to address operand if it is false
+    OP_CALL_GLOBAL, //Calls the function in global slot operand with the arguments of call site count from the stack
+    OP_CALL_LOCAL, //Calls the function in local slot operand with the arguments of call site count from the stack
+    OP_RETURN, //Pops the result, discards the frame and pushes the result for the caller
+    OP_PRINT_VALUE, //Pops and prints one argument of print()
+    OP_PRINT_END, //Ends a print() line and pushes its None result
+    OP_LENGTH, //Pops a list and pushes its length
+    OP_POP, //Discards the value of an expression statement
+    OP_HALT
+};
 
-    return root; //Return AST
-}
+struct Instruction {
+    OpCode op;
+    int operand = 0;
+    int count = 0;
+};
 
-//Recursive AST parse function
-ASTNode parseStatement(vector<vector<token>> tokens, int line, int tokenIndex, token lookahead) {
-    //Create AST node
-    ASTNode statement = ASTNode();
+//Call instruction: its argument count and a monomorphic inline cache, the function it called last. A call whose slot
+//still holds that function skips the arity check, rebinding the name to another function misses the cache
+struct CallSite {
+    int arguments;
+    const ASTNode* callee = nullptr;
+};
 
-    //<IDENTIFIER>
-    //If token is an identifier
-    if (lookahead.type == IDENTIFIER) {
-        if (DEBUG) cout << "<IDENTIFIER>"; //DEBUGGING
+//Compiled program. Every instruction keeps the AST node it was compiled from for error messages
+struct Bytecode {
+    vector<Instruction> code;
+    vector<Value> constants;
+    vector<const ASTNode*> sources;
+    mutable vector<CallSite> callSites; //Updated while the program runs
+};
 
-        statement.type = AST_IDENTIFIER; //Set type
-        statement.symbol = lookahead.value; //Set symbol
-        statement.line = lookahead.line; //Set line
+//Call frame of the virtual machine
+struct VMFrame {
+    int returnAddress;
+    int base; //Stack index of the first local
+};
 
-        //If the line only contains an identifier or if the identifier is the last element in the line, return identifier
-        if (tokens[line].size() == 1 || tokenIndex == tokens[line].size() - 1 || tokens[line][tokenIndex + 1].type == BLOCK_END) return statement;
-        
-        //Obtain following token to the identifier
-        lookahead = tokens[line][tokenIndex+1];
+//Parser state: a cursor over the shared, read-only token stream produced by the lexer
+//Finished nodes wait on pending until their parent is complete, then a whole list is placed in the arena at once
+struct Parser {
+    const TokenStream& stream;
+    int cursor;
+    AST& ast;
+    vector<ASTNode> pending;
+};
 
-        //<IDENTIFIER><EQUALS>
-        //if following token is an equal sign
-        if (lookahead.type == EQUALS) {
-            if (DEBUG) cout << "<EQUALS>"; //DEBUGGING
+//Thrown after an error message has been printed, stops the script that caused it
+struct ScriptError {};
 
-            statement.type = AST_ASSIGMENT; //Set type
-            statement.line = lookahead.line; //Set line
-            ASTNode expression = parseStatement(tokens, line, tokenIndex+2, tokens[line][tokenIndex+2]); //Parse expression after equal sign
+//Function Declarations
+string getInput(string input);
+int statementBoundary(string_view text);
+int scanScalar(const char* data, int index, int length, unsigned char characterClass);
+int scanSSE2(const char* data, int index, int length, unsigned char characterClass);
+int scanAVX2(const char* data, int index, int length, unsigned char characterClass);
+TokenType keywordType(string_view identifier);
+void interpretStream(int input);
+AST prepare(string_view source, int firstLine = 1, int firstPosition = 1);
+void runScript(const string& inputPath, string_view source, const string& engine, bool useCache, bool dumpOptimized);
+vector<string> batchScripts(const string& path);
+int runBatch(const string& batchPath, const string& engine, bool useCache, int jobs);
+bool runBatchScript(const string& path, const string& engine, bool useCache, size_t& lines);
+void runParallel(const vector<string>& scripts, const string& engine, bool useCache, int jobs, int& failed, size_t& lines);
+void resetInterpreter();
+Value valueOf(const minipython::ScriptValue& value);
+minipython::ScriptValue scriptValueOf(const Value& value);
+TokenStream lexer(string_view input, int firstLine = 1, int firstPosition = 1);
+token makeOneSymbolToken(TokenType type, int offset, int length, int line);
+string_view tokenText(const TokenStream& stream, const token& t);
+AST parseTree(const TokenStream& stream);
+const token& peek(Parser& parser, int ahead = 0);
+const token& advance(Parser& parser);
+const token& expect(Parser& parser, TokenType type, const string& symbol);
+NodeList placeOne(Parser& parser, const ASTNode& node);
+ASTNode parseStatement(Parser& parser);
+NodeList parseBlock(Parser& parser);
+ASTNode makeOperation(Parser& parser, const token& op, string_view value, const ASTNode& left, const ASTNode& right);
+ASTNode parseExpression(Parser& parser);
+ASTNode parseSum(Parser& parser);
+NodeList parseArguments(Parser& parser, TokenType closeType, const string& closeSymbol);
+ASTNode parseTerm(Parser& parser);
+void printASTTree(const ASTNode& node, int tabs); //DEBUGGING
+Value makeNumber(int integer);
+Value makeBoolean(bool boolean);
+Value makeNull();
+Value makeString(string_view str);
+Value makeList(int size);
+Value copyList(const ListObject& list);
+Value concatenate(const ListObject& list1, const ListObject& list2);
+ListObject& writableList(Value& value);
+Value makeFunction(const ASTNode* function);
+bool isTrue(const Value& value);
+Operator operatorOf(string_view symbol);
+Value operate(Operator op, const Value& term1, const Value& term2, int line);
+OperationKind operationKind(Operator op, const ASTNode& term1, const ASTNode& term2);
+Value operateIntegers(OperationKind kind, int integer1, int integer2);
+bool equalValues(const Value& term1, const Value& term2);
+int compareValues(const Value& term1, const Value& term2, int line);
+bool integerOf(const ASTNode& node, int& integer);
+void printValue(const Value& value);
+Value makeUndefined();
+void resolve(ASTNode& node, unordered_map<string_view, int>* locals = nullptr);
+void declareLocals(const ASTNode& node, unordered_map<string_view, int>& locals);
+Value& variable(const ASTNode& node);
+void checkCall(const Value& callee, const ASTNode& call, int arguments, const ASTNode*& cache);
+int listInteger(const Value& value, const char* message, int line);
+int checkIndex(const Value& list, const Value& index, const ASTNode& node);
+void optimize(AST& ast, ASTNode& node);
+const ASTNode* literalOf(const ASTNode& node);
+Value literalValue(const ASTNode& node);
+void makeLiteral(AST& ast, ASTNode& node, const Value& value);
+void interpret(const ASTNode& ASTRoot);
+Value traverse(const ASTNode& node);
+Bytecode compile(ASTNode& program);
+int emit(Bytecode& bytecode, OpCode op, const ASTNode& source, int operand = 0, int count = 0);
+int addConstant(Bytecode& bytecode, Value value);
+void compileStatement(Bytecode& bytecode, ASTNode& node);
+void compileExpression(Bytecode& bytecode, ASTNode& node);
+void run(const Bytecode& bytecode);
+
+//Source text of a script. Regular files are mapped into memory and lexed in place without copying them,
+//"-" and files that cannot be mapped (pipes, empty files) are read into a buffer
+class SourceFile {
+    public:
+        explicit SourceFile(const string& path) {
+            if (path == "-") {
+                buffer = string((istreambuf_iterator<char>(cin)), istreambuf_iterator<char>());
+                return;
+            }
+            int file = open(path.c_str(), O_RDONLY);
+            struct stat status;
+            if (file >= 0 && fstat(file, &status) == 0 && S_ISREG(status.st_mode) && status.st_size > 0) {
+                void* mapping = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+                if (mapping != MAP_FAILED) {
+                    data = static_cast<const char*>(mapping);
+                    size = status.st_size;
+                    madvise(mapping, size, MADV_SEQUENTIAL); //The lexer reads the file once from start to end
+                }
+            }
+            if (file >= 0) close(file);
+            if (data == nullptr) buffer = getInput(path);
+        }
 
-            statement.expression.push_back(expression); //Add expression to assigment node
-            return statement; 
+        ~SourceFile() {
+            if (data != nullptr) munmap(const_cast<char*>(data), size);
         }
 
-        //<IDENTIFIER><PLUS>
-        //if following token is a plus sign
-        if (lookahead.type == PLUS) {
-            if (DEBUG) cout << "<PLUS>";
+        SourceFile(const SourceFile&) = delete;
+        SourceFile& operator=(const SourceFile&) = delete;
 
-            ASTNode operation = ASTNode();
-            operation.type = AST_OPERATION; //Set type
-            operation.line = lookahead.line; //Set line
-            operation.value = "+"; //Set value
+        //Tokens and AST nodes point into this text, the SourceFile has to outlive them
+        string_view text() const {
+            if (data != nullptr) return string_view(data, size);
+            return buffer;
+        }
 
-            operation.parameters.push_back(statement); //Add identifier to parameters
-            operation.parameters.push_back(parseStatement(tokens, line, tokenIndex+2, tokens[line][tokenIndex+2])); //Add expression after plus sign to parameters
+    private:
+        const char* data = nullptr; //Mapped file, nullptr if the text is in buffer
+        size_t size = 0;
+        string buffer;
+};
 
-            return operation;
-        }
+//Part of a script read from a pipe. Its AST points into source and both stay alive until the program ends,
+//since functions defined in it can be called by later chunks
+struct SourceChunk {
+    string source;
+    AST ast;
+};
 
-        //<IDENTIFIER><OPEN_PARENTHESIS>
-        //if following token is an open parentheses
-        if (lookahead.type == OPEN_PARENTHESES) {
-            if (DEBUG) cout << "<OPEN_PARENTHESIS>"; //DEBUGGING
-
-            ASTNode functionCall = ASTNode();
-            functionCall.type = AST_FUNCTION_CALL; //Set type
-            functionCall.symbol = statement.symbol; //Set symbol
-            functionCall.line = lookahead.line; //Set line
-            int tokenIncrement = 2; //Increment to skip open parentheses
-            lookahead = tokens[line][tokenIndex+tokenIncrement]; //Get next token
-            while (lookahead.type != CLOSE_PARENTHESES) {
-                //Ignore commas
-                if (lookahead.type == COMMA) {
-                    tokenIncrement++;
-                    lookahead = tokens[line][tokenIndex+tokenIncrement];
-                    continue;
-                }
-                ASTNode expression = parseStatement(tokens, line, tokenIndex+tokenIncrement, lookahead); //parse parameter
-                functionCall.parameters.push_back(expression); //Add parameter to function call
-                tokenIncrement ++; //Increment to skip parameter
-                lookahead = tokens[line][tokenIndex+tokenIncrement]; //Get next token
-            }
-            if (DEBUG) cout << "<CLOSE_PARENTHESES>"; //DEBUGGING
-            return functionCall;
+//Variable storage of the interpreter. Values are read and written in place, evaluating a node never copies the table
+//Names are bound to slots once by the resolver, the interpreter only indexes the slot array
+class Environment {
+    public:
+        //Returns the slot bound to a variable name, creating it the first time the name is seen
+        int declare(const string& name) {
+            auto found = slots.find(name);
+            if (found != slots.end()) return found->second;
+            slots.emplace(name, globals.size());
+            globals.push_back(makeUndefined());
+            return globals.size() - 1;
         }
 
-        //<IDENTIFIER><CLOSE_PARENTHESIS>
-        //if following token is a close parentheses
-        if (lookahead.type == CLOSE_PARENTHESES) {
-            if (DEBUG) cout << "<CLOSE_PARENTHESIS>";
-            return statement;
+        Value& global(int slot) {
+            return globals[slot];
         }
 
-        //<IDENTIFIER><OPEN_BRACKET>
-        if (lookahead.type == OPEN_BRACKET) {
-            if (DEBUG) cout << "<OPEN_BRACKET>"; //DEBUGGING
-            ASTNode listIndex = ASTNode();
-            listIndex.type = AST_LIST_INDEX; //Set type
-            listIndex.symbol = statement.symbol; //Set symbol
-            listIndex.line = lookahead.line; //Set line
-            listIndex.parameters.push_back(parseStatement(tokens, line, tokenIndex+2, tokens[line][tokenIndex+2])); //Add expression after open bracket to parameters
-            if (DEBUG) cout << "<CLOSE_BRACKET>"; //DEBUGGING
-
-            int tokenIncrement = 2; //Increment to skip open bracket
-
-            while (lookahead.type != CLOSE_BRACKET) { 
-                if (tokens[line].size() > tokenIndex + tokenIncrement) {
-                    lookahead = tokens[line][tokenIndex+tokenIncrement];
-                    tokenIncrement++;
-                } else {
-                    cout << "Error: Missing ] at line " << line << endl;
-                    exit(1);
-                }
-            }
+        const Value& global(int slot) const {
+            return globals[slot];
+        }
 
-            //Check if there are more tokens after the close bracket
-            if (tokens[line].size() > tokenIndex+tokenIncrement) {
-                lookahead = tokens[line][tokenIndex+tokenIncrement];
-            } else {
-                //Not other tokens return listIndex
-                return listIndex;
-            }
-            
-            //<IDENTIFIER><OPEN_BRACKET>...<CLOSE_BRACKET><EQUALS>
-            //If following token is an equal sign
-            if (lookahead.type == EQUALS) {
-                if (DEBUG) cout << "<EQUALS>";
-                statement.type = AST_ASSIGMENT;
-                statement.line = lookahead.line;
-                lookahead = tokens[line][tokenIndex+tokenIncrement+1];
-                listIndex.expression.push_back(parseStatement(tokens, line, tokenIndex+tokenIncrement+1, lookahead));
-                statement.expression.push_back(listIndex);
-                return statement;
-            }
+        //Slot of a variable name, -1 if no script or host has used it
+        int find(const string& name) const {
+            auto found = slots.find(name);
+            return found != slots.end() ? found->second : -1;
+        }
 
-            //<IDENTIFIER><OPEN_BRACKET>...<CLOSE_BRACKET><PLUS>
-            if (lookahead.type == PLUS) { 
-                if (DEBUG) cout << "<OPERATOR>"; //DEBUGGING
-                ASTNode operation = ASTNode();
-                operation.type = AST_OPERATION;
-                operation.line = lookahead.line;
-                operation.value = lookahead.value;
+        //Unassigns every variable, slots stay bound so resolved programs can run again
+        void reset() {
+            for (Value& value : globals) value = makeUndefined();
+        }
 
-                operation.parameters.push_back(listIndex);
-                operation.parameters.push_back(parseStatement(tokens, line, tokenIndex+tokenIncrement+1, tokens[line][tokenIndex+tokenIncrement+1]));
+        //Forgets every name for the next script of a batch, the table keeps its memory
+        void clear() {
+            slots.clear();
+            globals.clear();
+        }
 
-                return operation;
-            }
+        int size() const {
+            return globals.size();
+        }
 
-            return listIndex;
+        //Variable names in slot order
+        vector<string_view> names() const {
+            vector<string_view> names(slots.size());
+            for (const auto& slot : slots) names[slot.second] = slot.first;
+            return names;
         }
 
-        //<IDENTIFIER><OPERATOR>
-        if (lookahead.type == OPERATOR) {
-            if (DEBUG) cout << "<OPERATOR>";
+    private:
+        unordered_map<string, int> slots; //Slot of every variable name
+        vector<Value> globals; //Stores all variables from the outer scope
+};
 
-            ASTNode operation = ASTNode();
-            operation.type = AST_OPERATION;
-            operation.line = lookahead.line;
-            operation.value = lookahead.value;
+thread_local Environment environment; //Interpreter state is per thread, the scripts of a parallel batch run side by side
 
-            operation.parameters.push_back(statement);
-            operation.parameters.push_back(parseStatement(tokens, line, tokenIndex+2, tokens[line][tokenIndex+2]));
+//A call frame holds the parameters and locals of one user function call and its return value
+struct Frame {
+    vector<Value> locals;
+    Value result;
+    bool returned = false; //Set by return so blocks stop executing
+};
 
-            return operation;
+//Call stack of the interpreter. Frames are preallocated and reused, so a call does not allocate once the stack is warm
+class CallStack {
+    public:
+        //Arguments are evaluated onto this stack before the frame of the callee is pushed
+        vector<Value> arguments;
+
+        //Pushes a frame for a function and moves its arguments from the argument stack into the first locals
+        Frame& push(int frameSize, int argumentCount) {
+            if (depth == (int)frames.size()) frames.emplace_back();
+            Frame& frame = frames[depth++];
+            frame.locals.resize(frameSize, makeUndefined());
+            frame.returned = false;
+            for (int i = 0; i < argumentCount; i++) {
+                frame.locals[i] = move(arguments[arguments.size() - argumentCount + i]);
+            }
+            arguments.resize(arguments.size() - argumentCount);
+            return frame;
         }
 
-        //<IDENTIFIER><OPEN_PARENTHESIS>
-        if (lookahead.type == OPEN_PARENTHESES) {
-            if (DEBUG) cout << "<OPEN_PARENTHESIS>";
-
-            ASTNode functionCall = ASTNode();
-            functionCall.type = AST_FUNCTION_CALL;
-            functionCall.line = lookahead.line;
-            functionCall.symbol = statement.symbol;
-
-            //If the function call has parameters
-            int tokenIncrement = 1;
-            while (tokenIndex+2+tokenIncrement < tokens[line].size()) {
-                lookahead = tokens[line][tokenIndex+2+tokenIncrement];
-                //if end of parameters reached
-                if (lookahead.type == CLOSE_PARENTHESES) break;
-
-                functionCall.parameters.push_back(parseStatement(tokens, line, tokenIndex+2+tokenIncrement, lookahead));
-            }
+        //Pops the current frame and returns the function result
+        Value pop() {
+            Frame& frame = frames[--depth];
+            Value result = move(frame.result);
+            frame.result = Value();
+            for (Value& local : frame.locals) local = makeUndefined();
+            return result;
+        }
 
-            return functionCall;
+        Frame& top() {
+            return frames[depth - 1];
         }
 
-        return statement;
-    }
+        int size() const {
+            return depth;
+        }
 
-    //<OPEN_PARENTHESIS>
-    //If token is an open parenthesis
-    if (lookahead.type == OPEN_PARENTHESES) {
-        if (DEBUG) cout << "<OPEN_PARENTHESIS>";
+        //True if a return statement finished the current function
+        bool returning() const {
+            return depth > 0 && frames[depth - 1].returned;
+        }
+
+        //Drops the calls left open by an error, frames stay allocated for the next script
+        void clear() {
+            while (depth > 0) pop();
+            arguments.clear();
+        }
 
-        ASTNode expression = ASTNode();
-        expression.type = AST_EXPRESSION;
-        expression.line = lookahead.line;
+    private:
+        deque<Frame> frames; //deque keeps references to frames valid when the stack grows
+        int depth = 0;
+};
 
-        int tokenIncrement = 1;
-        while (lookahead.type != CLOSE_PARENTHESES) {
-            //Get next token
-            lookahead = tokens[line][tokenIndex+tokenIncrement];
+thread_local CallStack callStack;
+const int MAX_CALL_DEPTH = 1000;
 
-            //Check if it is a comma if it is skip it
-            if (lookahead.type == COMMA) {
-                tokenIncrement++;
-                lookahead = tokens[line][tokenIndex+tokenIncrement];
-            }
+//Buffered standard output. print() formats straight into a large reusable buffer that is written with one write() call
+//when it is full, at exit and whenever error() is flushed. Error messages are written here too (see error()), so they
+//flush everything printed before them (they end with endl) and come out in order
+class Output {
+    public:
+        bool unbuffered = false; //Writes every line as soon as it ends, for interactive use
+        function<void(string_view)> sink; //Receives the output instead of stdout: parallel batch scripts, embedding hosts
 
-            //Check if it is a close parenthesis if it is break
-            if (lookahead.type == CLOSE_PARENTHESES) break;
+        ~Output() {
+            flush();
+        }
 
-            //Parse next token
-            ASTNode statement = parseStatement(tokens, line, tokenIndex+tokenIncrement, lookahead);
-            
-            //Add to parameters
-            expression.expression.push_back(statement);
-            tokenIncrement++;
+        void put(char c) {
+            if (used == sizeof(buffer)) flush();
+            buffer[used++] = c;
+        }
 
-            //move to the next comma or closing parenthesis
-            for (int i = tokenIndex+tokenIncrement; i < tokens[line].size(); i++) {
-                if (tokens[line][i].type == COMMA || tokens[line][i].type == CLOSE_PARENTHESES) {
-                    break;
+        void write(string_view text) {
+            if (text.size() > sizeof(buffer) - used) {
+                flush();
+                if (text.size() > sizeof(buffer)) {
+                    writeAll(text.data(), text.size());
+                    return;
                 }
-                tokenIncrement ++;
             }
-            
+            memcpy(buffer + used, text.data(), text.size());
+            used += text.size();
         }
 
-        return expression;
-    }
+        //Formats an integer without going through iostream and its locale
+        void writeInteger(int value) {
+            if (sizeof(buffer) - used < 16) flush();
+            used = to_chars(buffer + used, buffer + sizeof(buffer), value).ptr - buffer;
+        }
 
-    //<OPEN BRACKET>
-    //If token is an open bracket
-    if (lookahead.type == OPEN_BRACKET) {
-        if (DEBUG) cout << "<OPEN_BRACKET>";
+        void endLine() {
+            put('\n');
+            if (unbuffered) flush();
+        }
 
-        ASTNode list = ASTNode();
-        list.type = AST_LIST;
-        list.line = lookahead.line;
-        int tokenIncrement = 1;
+        void flush() {
+            writeAll(buffer, used);
+            used = 0;
+        }
 
-        while (lookahead.type != CLOSE_BRACKET) {
-            //Get token
-            lookahead = tokens[line][tokenIndex+tokenIncrement];
+    private:
+        char buffer[1 << 16];
+        int used = 0;
 
-            //Check if it is a comma if it is skip it
-            if (lookahead.type == COMMA) {
-                tokenIncrement++;
-                lookahead = tokens[line][tokenIndex+tokenIncrement];
+        void writeAll(const char* data, size_t size) {
+            if (sink) {
+                if (size > 0) sink(string_view(data, size));
+                return;
             }
+            while (size > 0) {
+                ssize_t written = ::write(STDOUT_FILENO, data, size);
+                if (written <= 0) return;
+                data += written;
+                size -= written;
+            }
+        }
+};
 
-            //Check if it is a close bracket if it is break
-            if (lookahead.type == CLOSE_BRACKET) break;
+thread_local Output output;
 
-            //Parse next token
-            ASTNode element = parseStatement(tokens, line, tokenIndex+tokenIncrement, lookahead);
+//Stream buffer that forwards everything to the output of the thread that writes it
+class OutputForwarder : public streambuf {
+    protected:
+        int overflow(int c) override {
+            if (c != EOF) output.put(c);
+            return c;
+        }
 
-            //Add to list expression
-            list.expression.push_back(element);
+        streamsize xsputn(const char* text, streamsize count) override {
+            output.write(string_view(text, count));
+            return count;
+        }
 
-            tokenIncrement++;
+        int sync() override {
+            output.flush();
+            return 0;
         }
+};
 
-        if (DEBUG) cout << "<CLOSE_BRACKET>";
+OutputForwarder outputForwarder;
 
-        tokenIncrement ++;
-        if (tokenIndex + tokenIncrement < tokens[line].size()) {
-            lookahead = tokens[line][tokenIndex+tokenIncrement];
-        } else {
-            return list;
-        }
+//Stream of the error messages of the interpreter. They go to the output of the calling thread, next to what the script
+//printed: stdout, the buffer of a parallel batch script or the sink of an embedded interpreter. cout is never touched, so
+//a host keeps its own cout (and whatever it redirected it to) while its interpreters run
+ostream& error() {
+    thread_local ostream stream(&outputForwarder);
+    return stream;
+}
 
-        if (lookahead.type == PLUS && tokens[line][tokenIndex+tokenIncrement+1].type != BLOCK_END) {
-            if (DEBUG) cout << "<OPERATOR>";
-            ASTNode operation = ASTNode();
-            operation.type = AST_OPERATION;
-            operation.line = lookahead.line;
-            operation.value = lookahead.value;
+//Heap allocations made by this thread, counted by operator new in the command line build
+thread_local size_t heapAllocations = 0;
 
-            operation.parameters.push_back(list);
-            operation.parameters.push_back(parseStatement(tokens, line, tokenIndex+tokenIncrement+1, tokens[line][tokenIndex+tokenIncrement+1]));
+//Runtime statistics reported by --stats on stderr: time and heap allocations of every phase, token and node counts,
+//peak memory and how many times the tree walker evaluated each node type
+class Stats {
+    public:
+        bool enabled = false;
+        size_t evaluations[NODE_TYPES] = {};
+        size_t tokens = 0;
+        size_t nodes = 0;
+
+        //Starts timing a phase. A phase begun inside another one is part of the outer phase (the passes of a streamed
+        //chunk are timed as "stream")
+        void begin(const char* name) {
+            if (!enabled || depth++ > 0) return;
+            current = {name, 0, heapAllocations};
+            start = chrono::steady_clock::now();
+        }
 
-            return operation;
+        void end() {
+            if (!enabled || --depth > 0) return;
+            phases.push_back(finish());
         }
-    }
 
-    //<NUMBER>
-    //If token is a number
-    if (lookahead.type == NUMBER) {
-        if (DEBUG) cout << "<NUMBER>";
+        void print() const {
+            rusage usage;
+            getrusage(RUSAGE_SELF, &usage);
 
-        statement.type = AST_NUMBER;
-        statement.line = lookahead.line;
-        statement.value = lookahead.value;
+            cerr << "---------------- STATS ----------------" << endl;
+            cerr << left << setw(12) << "Phase" << setw(14) << "Time (ms)" << "Allocations" << endl;
+            for (const Phase& phase : phases) {
+                cerr << setw(12) << phase.name << setw(14) << phase.milliseconds << phase.allocations << endl;
+            }
+            if (depth > 0) {
+                //An error ended the program in the middle of this phase
+                Phase stopped = finish();
+                cerr << setw(12) << stopped.name << setw(14) << stopped.milliseconds << stopped.allocations << " (stopped)" << endl;
+            }
+            cerr << "Tokens: " << tokens << endl;
+            cerr << "AST nodes: " << nodes << endl;
+            cerr << "Peak RSS: " << usage.ru_maxrss << " KB" << endl;
+
+            bool evaluated = false;
+            for (size_t count : evaluations) evaluated = evaluated || count > 0;
+            if (!evaluated) return;
+            cerr << "Evaluations by node type:" << endl;
+            for (int type = 0; type < NODE_TYPES; type++) {
+                if (evaluations[type] > 0) cerr << "  " << AST_NAMES[type] << "\t" << evaluations[type] << endl;
+            }
+        }
 
-        //If the line only contains a number or if the number is the last element in the line
-        if (tokens[line].size() == 1 || tokenIndex == tokens[line].size() - 1) return statement;
+    private:
+        struct Phase {
+            const char* name;
+            double milliseconds;
+            size_t allocations;
+        };
+
+        vector<Phase> phases;
+        Phase current;
+        int depth = 0; //Phases begun and not ended
+        chrono::steady_clock::time_point start;
+
+        //Measures the current phase up to now
+        Phase finish() const {
+            Phase phase = current;
+            phase.milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+            phase.allocations = heapAllocations - current.allocations;
+            return phase;
+        }
+};
 
-        lookahead = tokens[line][tokenIndex+1];
+thread_local Stats stats; //Of the main thread, the scripts of a parallel batch are not measured
 
-        //<NUMBER><PLUS>
-        if (lookahead.type == PLUS) {
-            if (DEBUG) cout << "<PLUS>";
+//Per-function profiler enabled with --profile. Calls of user functions are recorded in a call tree where every node is a
+//function called under a parent node, so the path from the root is a call stack. Call sites (a function called from a
+//source line) are counted separately, since every line of a script can call a function and keying the tree by line
+//would make it as large as the script. Time is read from the cycle counter (cheap enough to leave on) and converted to
+//nanoseconds once, when the report is written
+class Profiler {
+    public:
+        bool enabled = false;
+        string outputPath = "profile.folded"; //Collapsed stacks for flame graph tools
+
+        //Starts recording under the root frame "main", once per process
+        void start() {
+            if (!stack.empty()) return;
+            names.push_back("main");
+            active.push_back(0);
+            nodes.push_back(CallNode{0, -1});
+            stack.push_back({0, -1, ticks(), 0});
+            startTime = chrono::steady_clock::now();
+            startTicks = stack.back().start;
+        }
 
-            ASTNode operation = ASTNode();
-            operation.type = AST_OPERATION;
-            operation.line = lookahead.line;
-            operation.value = "+";
+        //A user function starts executing, line is the line of the call
+        void enter(const ASTNode& function, int line) {
+            auto site = siteIndex.try_emplace(SiteKey{&function, line}, sites.size());
+            if (site.second) sites.push_back(Site{nameOf(function), line});
+            int name = sites[site.first->second].name;
+            active[name] ++;
 
-            operation.parameters.push_back(statement);
-            operation.parameters.push_back(parseStatement(tokens, line, tokenIndex+2, tokens[line][tokenIndex+2]));
+            auto node = nodeIndex.try_emplace(NodeKey{name, stack.back().node}, nodes.size());
+            if (node.second) nodes.push_back(CallNode{name, stack.back().node});
+            stack.push_back({node.first->second, site.first->second, ticks(), 0});
+        }
 
-            return operation;
+        //The innermost user function returned
+        void exit() {
+            Call call = stack.back();
+            stack.pop_back();
+            uint64_t elapsed = ticks() - call.start;
+            uint64_t exclusive = elapsed - call.children;
+
+            CallNode& node = nodes[call.node];
+            node.calls ++;
+            node.exclusive += exclusive;
+            if (call.site >= 0) {
+                Site& site = sites[call.site];
+                site.calls ++;
+                site.exclusive += exclusive;
+                //Inclusive time of a recursive call is already inside the outermost call of the function
+                if (--active[node.name] == 0) site.inclusive += elapsed;
+            }
+            if (!stack.empty()) stack.back().children += elapsed;
         }
 
+        //Between the scripts of a batch: closes the calls left open by an error and forgets the AST nodes of the script,
+        //which is about to be freed. Functions of later scripts with the same name share its totals
+        void endScript() {
+            while (stack.size() > 1) exit();
+            nameIndex.clear();
+            siteIndex.clear();
+        }
+
+        //Closes the calls still open (an error stopped the program), writes the collapsed stacks and prints a summary
+        void report() {
+            if (stack.empty()) return;
+            while (!stack.empty()) exit(); //The root is closed last
+            double nanoseconds = chrono::duration<double, nano>(chrono::steady_clock::now() - startTime).count();
+            double scale = nanoseconds / max<uint64_t>(1, ticks() - startTicks); //Nanoseconds per tick
+
+            ofstream folded(outputPath);
+            for (int i = 0; i < (int)nodes.size(); i++) {
+                uint64_t exclusive = nodes[i].exclusive * scale;
+                if (exclusive > 0) folded << stackOf(i) << " " << exclusive << "\n";
+            }
+
+            //Per function totals, summed over its call sites
+            vector<Site> functions(names.size());
+            for (const Site& site : sites) {
+                Site& total = functions[site.name];
+                total.name = site.name;
+                total.calls += site.calls;
+                total.inclusive += site.inclusive;
+                total.exclusive += site.exclusive;
+            }
+            if (!functions.empty()) functions.erase(functions.begin()); //main
+            sort(functions.begin(), functions.end(), [](const Site& a, const Site& b) { return a.inclusive > b.inclusive; });
+
+            cerr << "---------------- PROFILE ----------------" << endl;
+            cerr << "Total: " << nanoseconds / 1e6 << " ms, collapsed stacks written to " << outputPath << endl;
+            cerr << left << setw(20) << "Function" << setw(12) << "Calls" << setw(18) << "Inclusive (ms)" << "Exclusive (ms)" << endl;
+            for (const Site& total : functions) {
+                cerr << setw(20) << names[total.name] << setw(12) << total.calls << setw(18) << total.inclusive * scale / 1e6
+                     << total.exclusive * scale / 1e6 << endl;
+            }
+
+            vector<Site> lines = sites;
+            sort(lines.begin(), lines.end(), [](const Site& a, const Site& b) { return a.line < b.line; });
+            cerr << left << setw(8) << "Line" << setw(20) << "Calls to" << setw(12) << "Calls" << setw(18) << "Inclusive (ms)" << "Exclusive (ms)" << endl;
+            for (const Site& site : lines) {
+                cerr << setw(8) << site.line << setw(20) << names[site.name] << setw(12) << site.calls
+                     << setw(18) << site.inclusive * scale / 1e6 << site.exclusive * scale / 1e6 << endl;
+            }
+        }
+
+    private:
+        struct CallNode {
+            int name; //Index in names
+            int parent;
+            uint64_t calls = 0;
+            uint64_t exclusive = 0; //Ticks not spent in user functions called from this one
+        };
+
+        struct Site {
+            int name = 0;
+            int line = 0;
+            uint64_t calls = 0;
+            uint64_t inclusive = 0; //Ticks
+            uint64_t exclusive = 0;
+        };
+
+        //Call in progress
+        struct Call {
+            int node;
+            int site; //-1 for the root
+            uint64_t start;
+            uint64_t children; //Ticks spent in calls made by this one
+        };
+
+        struct SiteKey {
+            const ASTNode* function;
+            int line;
+            bool operator==(const SiteKey& other) const { return function == other.function && line == other.line; }
+        };
+
+        struct NodeKey {
+            int name;
+            int parent;
+            bool operator==(const NodeKey& other) const { return name == other.name && parent == other.parent; }
+        };
+
+        struct KeyHash {
+            size_t operator()(const SiteKey& key) const { return (reinterpret_cast<uintptr_t>(key.function) >> 4) * 0x9E3779B97F4A7C15ull ^ key.line; }
+            size_t operator()(const NodeKey& key) const { return (size_t(key.parent) << 32 | unsigned(key.name)) * 0x9E3779B97F4A7C15ull; }
+        };
+
+        vector<string> names; //Function names, copied so the report does not depend on the lifetime of the AST
+        unordered_map<const ASTNode*, int> nameIndex;
+        vector<CallNode> nodes; //Root first, parents are always before their children
+        unordered_map<NodeKey, int, KeyHash> nodeIndex;
+        vector<Site> sites;
+        unordered_map<SiteKey, int, KeyHash> siteIndex;
+        vector<Call> stack;
+        vector<int> active; //Calls in progress of every function name, to find the outermost call of recursive functions
+        chrono::steady_clock::time_point startTime;
+        uint64_t startTicks = 0;
+
+        static uint64_t ticks() {
+#ifdef MINIPYTHON_X86
+            return __rdtsc();
+#else
+            return chrono::steady_clock::now().time_since_epoch().count();
+#endif
+        }
+
+        int nameOf(const ASTNode& function) {
+            auto found = nameIndex.try_emplace(&function, names.size());
+            if (found.second) {
+                auto known = find(names.begin(), names.end(), function.symbol);
+                found.first->second = known - names.begin();
+                if (known == names.end()) {
+                    names.push_back(string(function.symbol));
+                    active.push_back(0);
+                }
+            }
+            return found.first->second;
+        }
+
+        //Frames of a node separated by ';', outermost first
+        string stackOf(int node) const {
+            if (nodes[node].parent < 0) return names[nodes[node].name];
+            return stackOf(nodes[node].parent) + ";" + names[nodes[node].name];
+        }
+};
+
+thread_local Profiler profiler; //Of the main thread, the scripts of a parallel batch are not profiled
+
+//AST CACHE
+//--cache keeps the resolved and optimized AST of a script in <script>.cache, next to it, and loads it instead of lexing,
+//parsing, resolving and optimizing when the text of the script is unchanged. The file is the node arena as it is in
+//memory (lists are relative offsets, so it works at any address), followed by the constant lists, the global names in
+//slot order and one string table. Loading maps the file, copies the arena and points the string views of the nodes
+//into the mapped string table. There is no parsing, nodes are only relocated
+class ASTCache {
+    public:
+        static const int VERSION = 3; //Bump when ASTNode, the node kinds or what the resolver and optimizer produce change
+
+        ASTCache() = default;
+        ASTCache(const ASTCache&) = delete;
+        ASTCache& operator=(const ASTCache&) = delete;
+
+        ~ASTCache() {
+            if (data != nullptr) munmap(const_cast<char*>(data), size);
+        }
+
+        //Loads the AST of source from path and declares its globals. Returns false, leaving the AST untouched, if there is
+        //no cache or it was written for another text or by an incompatible build. The string views of the loaded nodes
+        //point into this object, it has to outlive the AST
+        bool load(const string& path, string_view source, AST& ast) {
+            int file = open(path.c_str(), O_RDONLY);
+            if (file < 0) return false;
+            struct stat status;
+            if (fstat(file, &status) == 0 && status.st_size >= (off_t)sizeof(Header)) {
+                void* mapping = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+                if (mapping != MAP_FAILED) {
+                    data = static_cast<const char*>(mapping);
+                    size = status.st_size;
+                }
+            }
+            close(file);
+            if (data == nullptr) return false;
+
+            Header header;
+            memcpy(&header, data, sizeof(Header));
+            if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION
+                || header.nodeSize != sizeof(ASTNode) || header.sourceSize != source.size()
+                || header.sourceHash != hash(source) || header.nodes <= 0 || header.lists < 0 || header.elements < 0
+                || header.globals < 0 || header.contentHash != hash(string_view(data + sizeof(Header), size - sizeof(Header)))) {
+                return false;
+            }
+
+            //Sections in file order, their sizes have to add up to the file size
+            size_t offset = sizeof(Header);
+            const char* nodes = section(offset, header.nodes * sizeof(ASTNode));
+            const char* listSizes = section(offset, header.lists * sizeof(int));
+            const char* elements = section(offset, header.elements * sizeof(int));
+            const char* globals = section(offset, header.globals * sizeof(StringReference));
+            strings = section(offset, header.stringsSize);
+            stringsSize = header.stringsSize;
+            if (strings == nullptr || offset != size) return false;
+
+            //Globals get the slots they had when the AST was resolved
+            for (int slot = 0; slot < header.globals; slot++) {
+                StringReference name;
+                memcpy(&name, globals + slot * sizeof(StringReference), sizeof(StringReference));
+                if (!valid(name.offset, name.length) || environment.declare(string(strings + name.offset, name.length)) != slot) return false;
+            }
+
+            AST loaded;
+            int remaining = header.elements;
+            for (int list = 0; list < header.lists; list++) {
+                int count;
+                memcpy(&count, listSizes + list * sizeof(int), sizeof(int));
+                if (count < 0 || count > remaining) return false;
+                remaining -= count;
+                Value value = makeList(count);
+                memcpy(value.list().begin(), elements, count * sizeof(int));
+                elements += count * sizeof(int);
+                loaded.lists.push_back(move(value));
+            }
+
+            loaded.nodes.resize(header.nodes);
+            memcpy(loaded.nodes.data(), nodes, header.nodes * sizeof(ASTNode));
+            for (int index = 0; index < header.nodes; index++) {
+                ASTNode& node = loaded.nodes[index];
+                if (node.type >= NODE_TYPES || node.builtin >= BUILTINS || node.operation > OPERATION_CONCAT_LIST
+                    || (node.constant != nullptr && node.type != AST_LIST) || !inside(index, node.childList, header.nodes)
+                    || !inside(index, node.parameterList, header.nodes) || !inside(index, node.expressionList, header.nodes)) return false;
+                if (!relocate(node.value) || !relocate(node.symbol)) return false;
+                if (node.constant != nullptr) {
+                    size_t list = reinterpret_cast<uintptr_t>(node.constant) - 1;
+                    if (list >= loaded.lists.size()) return false;
+                    node.constant = &loaded.lists[list];
+                }
+            }
+            ast = move(loaded);
+            return true;
+        }
+
+        //Writes the AST of source to path. The file is written under a temporary name and renamed, so a concurrent run
+        //never sees half a file. Returns false if it cannot be written (for example a read-only directory)
+        static bool save(const string& path, string_view source, const AST& ast) {
+            Header header;
+            memcpy(header.magic, MAGIC, sizeof(MAGIC));
+            header.sourceHash = hash(source);
+            header.sourceSize = source.size();
+            header.nodes = ast.nodes.size();
+
+            string strings;
+            unordered_map<string_view, StringReference> interned;
+            auto intern = [&](string_view text) {
+                auto found = interned.find(text);
+                if (found != interned.end()) return found->second;
+                StringReference reference = {(uint32_t)strings.size(), (uint32_t)text.size()};
+                strings.append(text);
+                interned.emplace(text, reference);
+                return reference;
+            };
+
+            //Constant lists are numbered in AST order, nodes store their number + 1 in place of the pointer
+            unordered_map<const Value*, uintptr_t> listNumbers;
+            vector<int> listSizes;
+            vector<int> elements;
+            for (const Value& list : ast.lists) {
+                listNumbers.emplace(&list, listSizes.size() + 1);
+                listSizes.push_back(list.list().size);
+                elements.insert(elements.end(), list.list().begin(), list.list().end());
+            }
+            header.lists = listSizes.size();
+            header.elements = elements.size();
+
+            //String views are stored as an offset into the string table in place of the pointer
+            vector<ASTNode> nodes = ast.nodes;
+            for (ASTNode& node : nodes) {
+                if (node.type != AST_LIST) node.constant = nullptr; //Inline caches of calls that already ran
+                StringReference value = intern(node.value);
+                StringReference symbol = intern(node.symbol);
+                node.value = string_view(reinterpret_cast<const char*>(uintptr_t(value.offset)), value.length);
+                node.symbol = string_view(reinterpret_cast<const char*>(uintptr_t(symbol.offset)), symbol.length);
+                if (node.constant != nullptr) node.constant = reinterpret_cast<const Value*>(listNumbers.at(node.constant));
+            }
+
+            vector<StringReference> globals;
+            for (string_view name : environment.names()) globals.push_back(intern(name));
+            header.globals = globals.size();
+            header.stringsSize = strings.size();
+
+            string content;
+            content.append(reinterpret_cast<const char*>(nodes.data()), nodes.size() * sizeof(ASTNode));
+            content.append(reinterpret_cast<const char*>(listSizes.data()), listSizes.size() * sizeof(int));
+            content.append(reinterpret_cast<const char*>(elements.data()), elements.size() * sizeof(int));
+            content.append(reinterpret_cast<const char*>(globals.data()), globals.size() * sizeof(StringReference));
+            content.append(strings);
+            header.contentHash = hash(content);
+
+            string temporary = path + "." + to_string(getpid()) + "." + to_string(std::hash<thread::id>()(this_thread::get_id()));
+            ofstream file(temporary, ios::binary);
+            file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+            file.write(content.data(), content.size());
+            file.close();
+            if (!file || rename(temporary.c_str(), path.c_str()) != 0) {
+                remove(temporary.c_str());
+                return false;
+            }
+            return true;
+        }
+
+        //Hash of the script text, 8 bytes at a time so checking a large script costs much less than lexing it
+        static uint64_t hash(string_view text) {
+            uint64_t value = 14695981039346656037ull ^ text.size();
+            size_t i = 0;
+            for (; i + 8 <= text.size(); i += 8) {
+                uint64_t word;
+                memcpy(&word, text.data() + i, 8);
+                value = (value ^ word) * 0x9E3779B97F4A7C15ull;
+                value ^= value >> 29;
+            }
+            for (; i < text.size(); i++) value = (value ^ (unsigned char)text[i]) * 1099511628211ull;
+            return value;
+        }
+
+    private:
+        static constexpr char MAGIC[8] = {'M', 'P', 'Y', 'A', 'S', 'T', '\r', '\n'};
+
+        struct Header {
+            char magic[8];
+            int version = VERSION;
+            int nodeSize = sizeof(ASTNode); //Nodes are stored as they are in memory, only the same layout can read them
+            uint64_t sourceHash;
+            uint64_t sourceSize;
+            uint64_t contentHash; //Everything after the header, a damaged file is rebuilt instead of loaded
+            int nodes;
+            int lists; //Constant lists
+            int elements; //Elements of all constant lists
+            int globals;
+            uint64_t stringsSize;
+        };
+
+        struct StringReference {
+            uint32_t offset;
+            uint32_t length;
+        };
+
+        const char* data = nullptr; //Mapped cache file
+        size_t size = 0;
+        const char* strings = nullptr; //String table in the mapping
+        size_t stringsSize = 0;
+
+        //Returns the next section of the file and moves offset past it, nullptr if the file is too short
+        const char* section(size_t& offset, size_t length) {
+            if (offset > size || length > size - offset) {
+                offset = size + 1;
+                return nullptr;
+            }
+            const char* start = data + offset;
+            offset += length;
+            return start;
+        }
+
+        bool valid(size_t offset, size_t length) const {
+            return offset <= stringsSize && length <= stringsSize - offset;
+        }
+
+        //A node list of a loaded node has to stay inside the arena
+        static bool inside(int index, const NodeList& list, int nodes) {
+            long first = (long)index + list.offset;
+            return list.count >= 0 && first >= 0 && first + list.count <= nodes;
+        }
+
+        //Turns a stored string table reference back into a view of the mapping
+        bool relocate(string_view& view) {
+            size_t offset = reinterpret_cast<uintptr_t>(view.data());
+            if (!valid(offset, view.size())) return false;
+            view = string_view(strings + offset, view.size());
+            return true;
+        }
+};
+
+//Work stealing task queues of a parallel batch. Tasks are indices, every worker starts with a contiguous range of them
+//and takes them from the front of its own queue, in script order. A worker whose queue is empty steals from the back of
+//the queue of another worker, the tasks furthest from what its owner is running. Tasks never create tasks, so the
+//queues only shrink and a worker is done when every queue is empty
+class TaskPool {
+    public:
+        TaskPool(int tasks, int workers) : queues(workers) {
+            for (int worker = 0; worker < workers; worker++) {
+                for (int task = (long)tasks * worker / workers; task < (long)tasks * (worker + 1) / workers; task++) {
+                    queues[worker].tasks.push_back(task);
+                }
+            }
+        }
+
+        //Next task of a worker, -1 when there is nothing left to run
+        int next(int worker) {
+            {
+                Queue& own = queues[worker];
+                lock_guard<mutex> lock(own.access);
+                if (!own.tasks.empty()) {
+                    int task = own.tasks.front();
+                    own.tasks.pop_front();
+                    return task;
+                }
+            }
+            for (int i = 1; i < (int)queues.size(); i++) {
+                Queue& victim = queues[(worker + i) % queues.size()];
+                lock_guard<mutex> lock(victim.access);
+                if (!victim.tasks.empty()) {
+                    int task = victim.tasks.back();
+                    victim.tasks.pop_back();
+                    return task;
+                }
+            }
+            return -1;
+        }
+
+    private:
+        struct Queue {
+            mutex access;
+            deque<int> tasks;
+        };
+
+        vector<Queue> queues;
+};
+
+#ifndef MINIPYTHON_NO_MAIN
+//Counts heap allocations for --stats. Only the command line build replaces the global allocator. The replacements are
+//not inlined, so the compiler does not pair a new expression with the free() inside them (-Wmismatched-new-delete)
+__attribute__((noinline)) void* operator new(size_t size) {
+    heapAllocations ++;
+    void* memory = malloc(size == 0 ? 1 : size);
+    if (memory == nullptr) throw bad_alloc();
+    return memory;
+}
+
+__attribute__((noinline)) void operator delete(void* memory) noexcept {
+    free(memory);
+}
+
+__attribute__((noinline)) void operator delete(void* memory, size_t) noexcept {
+    free(memory);
+}
+
+int main(int argc, char* argv[]) {
+    //Command line: minipython [--engine=tree|vm] [--dump-optimized] [--unbuffered] [--stats] [--profile[=file]] [--cache] file.py|-
+    //              minipython [--engine=tree|vm] [--cache] [--jobs[=n]] --batch list.txt|directory
+    string engine = "tree";
+    string inputPath = "";
+    bool dumpOptimized = false;
+    bool useCache = false;
+    bool batch = false;
+    int jobs = 1;
+    for (int i = 1; i < argc; i++) {
+        string argument = argv[i];
+        if (argument.rfind("--engine=", 0) == 0) {
+            engine = argument.substr(9);
+        } else if (argument == "--dump-optimized") {
+            dumpOptimized = true;
+        } else if (argument == "--unbuffered") {
+            output.unbuffered = true;
+        } else if (argument == "--stats") {
+            stats.enabled = true;
+        } else if (argument == "--cache") {
+            useCache = true;
+        } else if (argument == "--batch") {
+            batch = true;
+        } else if (argument == "--jobs" || argument.rfind("--jobs=", 0) == 0) {
+            jobs = thread::hardware_concurrency();
+            string_view count = string_view(argument).substr(min<size_t>(7, argument.size()));
+            from_chars_result parsed = from_chars(count.data(), count.data() + count.size(), jobs);
+            if (!count.empty() && (parsed.ec != errc() || parsed.ptr != count.data() + count.size())) {
+                error() << "ERROR: --jobs expects a number of threads, not " << count << endl;
+                exit(1);
+            }
+            jobs = max(1, jobs);
+        } else if (argument == "--profile" || argument.rfind("--profile=", 0) == 0) {
+            profiler.enabled = true;
+            if (argument.size() > 10) profiler.outputPath = argument.substr(10);
+        } else {
+            inputPath = argument;
+        }
+    }
+    if (engine != "tree" && engine != "vm") {
+        error() << "ERROR: Unknown engine " << engine << ", use --engine=tree or --engine=vm" << endl;
+        exit(1);
+    }
+
+    //Errors print their message and stop the script with a ScriptError
+    int status = 0;
+    try {
+        if (batch) {
+            status = runBatch(inputPath, engine, useCache, jobs);
+        } else if (inputPath == "-" && engine == "tree" && !dumpOptimized) {
+            //A script piped into stdin starts running before it has been read completely. The virtual machine needs the
+            //whole program to link calls to function bodies, so it reads all of stdin first
+            if (profiler.enabled) profiler.start();
+            stats.begin("stream");
+            interpretStream(STDIN_FILENO);
+            stats.end();
+        } else {
+            //Obtain input from file, mapped into memory
+            stats.begin("input");
+            SourceFile pythonFile(inputPath);
+            stats.end();
+
+            runScript(inputPath, pythonFile.text(), engine, useCache && inputPath != "-", dumpOptimized);
+        }
+    } catch (const ScriptError&) {
+        status = 1;
+    }
+
+    //Reports include the phases and calls of a script stopped by an error
+    if (stats.enabled) stats.print();
+    if (profiler.enabled) profiler.report();
+    return status;
+}
+#endif
+
+//INPUT FUNCTION
+string getInput(string input) {
+    //Obtains a string from the input python file
+    ifstream inputFile(input);
+    if (!inputFile.is_open()) {
+        error() << "No parameters were passed" << endl;
+        throw ScriptError();
+    }
+    return string((istreambuf_iterator<char>(inputFile)), istreambuf_iterator<char>());
+}
+
+//STREAMING INPUT
+//Runs a script read from a pipe while it is being read. Input is read in chunks and every complete top level statement
+//is lexed, parsed and interpreted as soon as the line that starts the next top level statement arrives
+void interpretStream(int input) {
+    deque<SourceChunk> chunks; //deque keeps chunks in place, earlier ASTs are referenced by function values
+    string pending; //Text read but not run yet
+    int line = 1;
+    int position = 1;
+    char buffer[1 << 16];
+
+    while (true) {
+        ssize_t bytes = read(input, buffer, sizeof(buffer));
+        bool finished = bytes <= 0;
+        if (!finished) pending.append(buffer, bytes);
+
+        int end = finished ? pending.size() : statementBoundary(pending);
+        if (end > 0) {
+            chunks.emplace_back();
+            SourceChunk& chunk = chunks.back();
+            chunk.source = pending.substr(0, end);
+            pending.erase(0, end);
+
+            chunk.ast = prepare(chunk.source, line, position);
+            line += count(chunk.source.begin(), chunk.source.end(), '\n');
+            position += end;
+            interpret(chunk.ast.root());
+            output.flush(); //Show the output of every chunk without waiting for the end of the input
+        }
+        if (finished) break;
+    }
+}
+
+//Returns the offset of the last complete line that starts a new top level statement, or 0 if there is none.
+//Everything before it is a sequence of complete statements. else lines continue the if statement before them
+int statementBoundary(string_view text) {
+    size_t lineEnd = text.rfind('\n');
+    while (lineEnd != string_view::npos && lineEnd > 0) {
+        size_t lineStart = text.rfind('\n', lineEnd - 1);
+        lineStart = lineStart == string_view::npos ? 0 : lineStart + 1;
+
+        char first = text[lineStart];
+        bool statement = first != ' ' && first != '\n' && first != '#' && first != '\r';
+        if (statement && text.compare(lineStart, 4, "else") == 0) {
+            char next = lineStart + 4 < text.size() ? text[lineStart + 4] : '\n';
+            statement = CHARACTERS.is(next, CHAR_IDENTIFIER); //Identifiers like elsewhere still start a statement
+        }
+        if (statement && lineStart > 0) return lineStart;
+
+        if (lineStart == 0) break;
+        lineEnd = lineStart - 1;
+    }
+    return 0;
+}
+
+//SCRIPT PIPELINE
+//Lexes, parses, resolves and optimizes the text of a script into the AST both engines run. firstLine and firstPosition
+//number the first character of the text, for chunks of a longer input. The AST points into the source, which has to
+//outlive it
+AST prepare(string_view source, int firstLine, int firstPosition) {
+    //Lexer
+    stats.begin("lexer");
+    TokenStream tokens = lexer(source, firstLine, firstPosition);
+    stats.end();
+    stats.tokens += tokens.tokens.size();
+
+    //Parser
+    stats.begin("parser");
+    AST ast = parseTree(tokens);
+    stats.end();
+    stats.nodes += ast.nodes.size();
+
+    //Resolver
+    stats.begin("resolver");
+    resolve(ast.root());
+    stats.end();
+
+    if (DEBUG) {
+        cout << "\n" << "****************AST TREE****************" << endl;
+        //Print AST Tree
+        printASTTree(ast.root(), 0);
+    }
+
+    //Optimizer
+    stats.begin("optimizer");
+    optimize(ast, ast.root());
+    stats.end();
+    return ast;
+}
+
+//Lexes, parses, resolves, optimizes and runs the text of one script with the chosen engine, or loads its AST from the
+//cache. The source has to stay alive until the script has finished running
+void runScript(const string& inputPath, string_view source, const string& engine, bool useCache, bool dumpOptimized) {
+    //AST cache: a script that has not changed since its cache was written skips the passes up to the optimizer
+    AST ast;
+    ASTCache cache;
+    string cachePath = inputPath + ".cache";
+    bool cached = false;
+    if (useCache) {
+        stats.begin("cache load");
+        cached = cache.load(cachePath, source, ast);
+        stats.end();
+    }
+
+    if (!cached) {
+        ast = prepare(source);
+
+        //The script still runs if the cache cannot be written
+        if (useCache) {
+            stats.begin("cache save");
+            ASTCache::save(cachePath, source, ast);
+            stats.end();
+        }
+    } else {
+        stats.nodes += ast.nodes.size();
+    }
+
+    //Print the rewritten tree instead of running the program
+    if (dumpOptimized) {
+        printASTTree(ast.root(), 0);
+        return;
+    }
+
+    //Interpreter: tree walker or bytecode virtual machine
+    if (profiler.enabled) profiler.start();
+    if (engine == "vm") {
+        stats.begin("compile");
+        Bytecode bytecode = compile(ast.root());
+        stats.end();
+        stats.begin("run");
+        run(bytecode);
+        stats.end();
+    } else {
+        stats.begin("interpret");
+        interpret(ast.root());
+        stats.end();
+    }
+}
+
+//BATCH MODE
+//--batch runs many scripts in this process, so startup is paid once. Every script starts from an empty environment and
+//call stack, the variable table, call frames and output buffer keep their memory between scripts. An error stops only
+//the script that caused it. Output goes to stdout in script order, totals go to stderr
+int runBatch(const string& batchPath, const string& engine, bool useCache, int jobs) {
+    vector<string> scripts = batchScripts(batchPath);
+    int failed = 0;
+    size_t lines = 0;
+    auto start = chrono::steady_clock::now();
+    if (jobs > 1) {
+        runParallel(scripts, engine, useCache, jobs, failed, lines);
+    } else {
+        for (const string& path : scripts) {
+            if (!runBatchScript(path, engine, useCache, lines)) {
+                failed++;
+                cerr << "Failed: " << path << endl;
+            }
+        }
+    }
+    output.flush();
+
+    double milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    cerr << "Batch: " << scripts.size() << " scripts (" << failed << " failed), " << lines << " lines in " << milliseconds
+         << " ms, " << scripts.size() * 1000 / milliseconds << " scripts/s, " << lines * 1000 / milliseconds << " lines/s" << endl;
+    return failed > 0 ? 1 : 0;
+}
+
+//Runs one script of a batch on the interpreter state of the calling thread, false if it stopped with an error
+bool runBatchScript(const string& path, const string& engine, bool useCache, size_t& lines) {
+    bool succeeded = true;
+    resetInterpreter();
+    try {
+        SourceFile source(path);
+        lines += count(source.text().begin(), source.text().end(), '\n');
+        runScript(path, source.text(), engine, useCache, false);
+    } catch (const ScriptError&) {
+        succeeded = false;
+    }
+    resetInterpreter();
+    return succeeded;
+}
+
+//--jobs: the scripts run on a pool of worker threads, each with its own interpreter state (environment, call stack and
+//output are thread_local). The output of every script is collected in memory and this thread writes it in script
+//order as soon as the scripts before it have finished, so the output is the same as a sequential batch
+void runParallel(const vector<string>& scripts, const string& engine, bool useCache, int jobs, int& failed, size_t& lines) {
+    struct Result {
+        string output;
+        size_t lines = 0;
+        bool failed = false;
+        bool done = false;
+    };
+    vector<Result> results(scripts.size());
+    mutex doneMutex;
+    condition_variable doneSignal;
+    jobs = min<int>(jobs, max<size_t>(1, scripts.size()));
+    TaskPool pool(scripts.size(), jobs);
+
+    vector<thread> workers;
+    for (int worker = 0; worker < jobs; worker++) {
+        workers.emplace_back([&, worker] {
+            for (int task = pool.next(worker); task >= 0; task = pool.next(worker)) {
+                Result& result = results[task];
+                output.sink = [&result](string_view text) { result.output.append(text); };
+                bool succeeded = runBatchScript(scripts[task], engine, useCache, result.lines);
+                output.flush();
+                output.sink = nullptr;
+
+                lock_guard<mutex> lock(doneMutex);
+                result.failed = !succeeded;
+                result.done = true;
+                doneSignal.notify_one();
+            }
+        });
+    }
+
+    for (int task = 0; task < (int)scripts.size(); task++) {
+        Result& result = results[task];
+        {
+            unique_lock<mutex> lock(doneMutex);
+            doneSignal.wait(lock, [&] { return result.done; });
+        }
+        output.write(result.output);
+        string().swap(result.output); //Only the outputs of scripts that finished early are held in memory
+        lines += result.lines;
+        if (result.failed) {
+            failed++;
+            cerr << "Failed: " << scripts[task] << endl;
+        }
+    }
+    for (thread& worker : workers) worker.join();
+}
+
+//Scripts of a batch: the .py files of a directory in name order, or the paths listed one per line in a file
+vector<string> batchScripts(const string& path) {
+    vector<string> scripts;
+    if (filesystem::is_directory(path)) {
+        for (const auto& entry : filesystem::directory_iterator(path)) {
+            if (entry.is_regular_file() && entry.path().extension() == ".py") scripts.push_back(entry.path().string());
+        }
+        sort(scripts.begin(), scripts.end());
+        return scripts;
+    }
+    istringstream list(getInput(path));
+    string line;
+    while (getline(list, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (!line.empty()) scripts.push_back(line);
+    }
+    return scripts;
+}
+
+//Empty interpreter state for the next script of a batch
+void resetInterpreter() {
+    environment.clear();
+    callStack.clear();
+    profiler.endScript();
+}
+
+//LIBRARY API
+//Implementation of minipython.h. An Interpreter owns its script, AST, bytecode and variables. While it loads or runs a
+//script its variables are swapped into the environment of the calling thread and its sink into the output of the thread,
+//so the interpreter itself is the same code the command line runs
+struct minipython::Interpreter::State {
+    string source; //The AST points into it
+    AST ast;
+    Bytecode bytecode;
+    Engine engine = ENGINE_TREE;
+    bool loaded = false;
+    Environment variables;
+    function<void(string_view)> sink;
+};
+
+//Makes the variables and sink of an embedded interpreter those of the calling thread for its lifetime
+class Activation {
+    public:
+        Activation(Environment& variables, const function<void(string_view)>& sink) : variables(variables) {
+            output.flush();
+            previousSink = move(output.sink);
+            output.sink = sink;
+            swap(environment, variables);
+        }
+
+        ~Activation() {
+            output.flush();
+            output.sink = move(previousSink);
+            callStack.clear(); //Calls left open by an error
+            swap(environment, variables);
+        }
+
+        Activation(const Activation&) = delete;
+        Activation& operator=(const Activation&) = delete;
+
+    private:
+        Environment& variables;
+        function<void(string_view)> previousSink;
+};
+
+minipython::Interpreter::Interpreter() : state(make_unique<State>()) {}
+minipython::Interpreter::~Interpreter() = default;
+minipython::Interpreter::Interpreter(Interpreter&& other) noexcept = default;
+minipython::Interpreter& minipython::Interpreter::operator=(Interpreter&& other) noexcept = default;
+
+bool minipython::Interpreter::load(string_view source, Engine engine) {
+    //Functions point into the AST that is about to be replaced
+    for (int slot = 0; slot < state->variables.size(); slot++) {
+        if (state->variables.global(slot).type == VALUE_FUNCTION) state->variables.global(slot) = makeUndefined();
+    }
+    state->loaded = false;
+    state->bytecode = Bytecode();
+    state->ast = AST();
+    state->source = string(source);
+    state->engine = engine;
+
+    Activation activation(state->variables, state->sink);
+    try {
+        state->ast = prepare(state->source);
+        if (engine == ENGINE_VM) state->bytecode = compile(state->ast.root());
+    } catch (const ScriptError&) {
+        return false;
+    }
+    state->loaded = true;
+    return true;
+}
+
+bool minipython::Interpreter::run() {
+    if (!state->loaded) return false;
+    Activation activation(state->variables, state->sink);
+    try {
+        if (state->engine == ENGINE_VM) ::run(state->bytecode);
+        else interpret(state->ast.root());
+    } catch (const ScriptError&) {
+        return false;
+    }
+    return true;
+}
+
+void minipython::Interpreter::reset() {
+    state->variables.reset();
+}
+
+void minipython::Interpreter::setGlobal(const string& name, const ScriptValue& value) {
+    if (value.type == SCRIPT_FUNCTION) return;
+    state->variables.global(state->variables.declare(name)) = valueOf(value);
+}
+
+minipython::ScriptValue minipython::Interpreter::getGlobal(const string& name) const {
+    int slot = state->variables.find(name);
+    if (slot < 0) return ScriptValue::undefined();
+    return scriptValueOf(state->variables.global(slot));
+}
+
+void minipython::Interpreter::setOutput(function<void(string_view)> sink) {
+    state->sink = move(sink);
+}
+
+//Interpreter value of a value given by the host
+Value valueOf(const minipython::ScriptValue& value) {
+    switch (value.type) {
+        case minipython::SCRIPT_NUMBER: return makeNumber(value.integer);
+        case minipython::SCRIPT_BOOLEAN: return makeBoolean(value.integer != 0);
+        case minipython::SCRIPT_STRING: return makeString(value.text);
+        case minipython::SCRIPT_NULL: return makeNull();
+        case minipython::SCRIPT_LIST: {
+            Value list = makeList(value.list.size());
+            if (!value.list.empty()) memcpy(list.list().begin(), value.list.data(), value.list.size() * sizeof(int));
+            return list;
+        }
+        case minipython::SCRIPT_NONE: return Value();
+        default: return makeUndefined();
+    }
+}
+
+//Copy of an interpreter value for the host
+minipython::ScriptValue scriptValueOf(const Value& value) {
+    minipython::ScriptValue result;
+    switch (value.type) {
+        case VALUE_NUMBER: return value.integer;
+        case VALUE_BOOLEAN: return value.boolean;
+        case VALUE_STRING: return value.str();
+        case VALUE_LIST: return vector<int>(value.list().begin(), value.list().end());
+        case VALUE_NULL: result.type = minipython::SCRIPT_NULL; break;
+        case VALUE_FUNCTION:
+            result.type = minipython::SCRIPT_FUNCTION;
+            result.text = string(value.function->symbol);
+            break;
+        case VALUE_UNDEFINED: return minipython::ScriptValue::undefined();
+        default: break;
+    }
+    return result;
+}
+
+//LEXER SCANNING
+//Run scanners: return the index of the first byte at or after index that is not in the character class (length if the
+//run reaches the end). The vector versions test 16 or 32 bytes per step and only load whole blocks inside the input
+int scanScalar(const char* data, int index, int length, unsigned char characterClass) {
+    while (index < length && CHARACTERS.is(data[index], characterClass)) index ++;
+    return index;
+}
+
+#ifdef MINIPYTHON_X86
+//Sets every byte of a block that is in the character class to 0xFF. Bytes above 127 compare as negative and are in no class
+static inline __m128i classMaskSSE2(__m128i block, unsigned char characterClass) {
+    if (characterClass == CHAR_SPACE) return _mm_cmpeq_epi8(block, _mm_set1_epi8(' '));
+    __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(block, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(block, _mm_set1_epi8('9' + 1)));
+    if (characterClass == CHAR_DIGIT) return digit;
+    __m128i lower = _mm_or_si128(block, _mm_set1_epi8(0x20)); //Folds upper case letters into lower case
+    __m128i letter = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(lower, _mm_set1_epi8('z' + 1)));
+    __m128i underscore = _mm_cmpeq_epi8(block, _mm_set1_epi8('_'));
+    return _mm_or_si128(_mm_or_si128(digit, letter), underscore);
+}
+
+int scanSSE2(const char* data, int index, int length, unsigned char characterClass) {
+    while (index + 16 <= length) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + index));
+        unsigned outside = ~_mm_movemask_epi8(classMaskSSE2(block, characterClass)) & 0xFFFF;
+        if (outside != 0) return index + __builtin_ctz(outside);
+        index += 16;
+    }
+    return scanScalar(data, index, length, characterClass);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i classMaskAVX2(__m256i block, unsigned char characterClass) {
+    if (characterClass == CHAR_SPACE) return _mm256_cmpeq_epi8(block, _mm256_set1_epi8(' '));
+    __m256i digit = _mm256_andnot_si256(_mm256_cmpgt_epi8(block, _mm256_set1_epi8('9')), _mm256_cmpgt_epi8(block, _mm256_set1_epi8('0' - 1)));
+    if (characterClass == CHAR_DIGIT) return digit;
+    __m256i lower = _mm256_or_si256(block, _mm256_set1_epi8(0x20));
+    __m256i letter = _mm256_andnot_si256(_mm256_cmpgt_epi8(lower, _mm256_set1_epi8('z')), _mm256_cmpgt_epi8(lower, _mm256_set1_epi8('a' - 1)));
+    __m256i underscore = _mm256_cmpeq_epi8(block, _mm256_set1_epi8('_'));
+    return _mm256_or_si256(_mm256_or_si256(digit, letter), underscore);
+}
+
+__attribute__((target("avx2")))
+int scanAVX2(const char* data, int index, int length, unsigned char characterClass) {
+    while (index + 32 <= length) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + index));
+        unsigned outside = ~(unsigned)_mm256_movemask_epi8(classMaskAVX2(block, characterClass));
+        if (outside != 0) return index + __builtin_ctz(outside);
+        index += 32;
+    }
+    return scanSSE2(data, index, length, characterClass);
+}
+#else
+int scanSSE2(const char* data, int index, int length, unsigned char characterClass) {
+    return scanScalar(data, index, length, characterClass);
+}
+
+int scanAVX2(const char* data, int index, int length, unsigned char characterClass) {
+    return scanScalar(data, index, length, characterClass);
+}
+#endif
+
+//Picks the widest scanner the processor supports, once at startup
+using ScanFunction = int (*)(const char* data, int index, int length, unsigned char characterClass);
+
+ScanFunction chooseScanner() {
+#ifdef MINIPYTHON_X86
+    if (__builtin_cpu_supports("avx2")) return scanAVX2;
+    return scanSSE2;
+#else
+    return scanScalar;
+#endif
+}
+
+ScanFunction scanClass = chooseScanner(); //Not const so benchmarks can compare the scanners
+
+//Token type of an identifier: a keyword or IDENTIFIER. Switching on the length first skips most comparisons
+TokenType keywordType(string_view identifier) {
+    switch (identifier.size()) {
+        case 2: if (identifier == "if") return IF; break;
+        case 3:
+            if (identifier == "len") return LENGTH;
+            if (identifier == "def") return FUNCTION_DEFINITION;
+            break;
+        case 4:
+            if (identifier == "else") return ELSE;
+            if (identifier == "True") return TRUE;
+            if (identifier == "None") return NULL_IDENTIFIER;
+            break;
+        case 5:
+            if (identifier == "print") return PRINT;
+            if (identifier == "False") return FALSE;
+            break;
+        case 6: if (identifier == "return") return RETURN; break;
+    }
+    return IDENTIFIER;
+}
+
+//LEXER (TOKENIZER)
+TokenStream lexer(string_view input, int firstLine, int firstPosition) {
+    if (DEBUG) cout << "****************LEXER****************" << endl;
+    //Token offsets and lengths are ints, longer inputs would be truncated
+    if (input.length() > INT_MAX) {
+        error() << "ERROR: Input of " << input.length() << " bytes is too large, the limit is " << INT_MAX << " bytes" << endl;
+        throw ScriptError();
+    }
+    TokenStream stream; //Flat token stream. Every statement ends with a NEW_LINE token and indented blocks are wrapped by BLOCK_START and BLOCK_END tokens
+    stream.source = input;
+    vector<token>& tokens = stream.tokens;
+    tokens.reserve(input.length() / 3 + 16);
+    vector<int> indentationStack = {0}; //Stores the indentation length (number of spaces) of every open block
+    int line = firstLine; //Stores line of code in input file. Scripts lexed in chunks start after the previous chunk
+    //Positions in error messages are offset + firstPosition, so chunks report positions in the whole file
+    int currIndex = 0; //Stores current index of input string (Entire file)
+    int length = input.length();
+    const char* data = input.data();
+    bool lineStart = true; //True until the indentation of the current line has been checked
+    bool lineHasTokens = false; //True if a token was found on the current line
+
+    while (currIndex < length) {
+        char lookahead = input[currIndex]; //Stores lookahead character
+
+        //INDENTATION
+        //At the start of a line obtain its indentation and open or close blocks. Empty lines and comments are ignored.
+        if (lineStart) {
+            int indentation = scanClass(data, currIndex, length, CHAR_SPACE) - currIndex;
+            char next = currIndex + indentation < length ? input[currIndex + indentation] : '\n';
+            if (next != '\n' && next != '#') {
+                int offset = currIndex + indentation;
+                if (indentation > indentationStack.back()) {
+                    indentationStack.push_back(indentation);
+                    tokens.push_back(makeOneSymbolToken(BLOCK_START, offset, 0, line));
+                }
+                while (indentation < indentationStack.back()) {
+                    indentationStack.pop_back();
+                    tokens.push_back(makeOneSymbolToken(BLOCK_END, offset, 0, line));
+                }
+                if (indentation != indentationStack.back()) {
+                    error() << "ERROR: Invalid indentation at line " << line << " position " << offset + firstPosition << endl;
+                    throw ScriptError();
+                }
+            }
+            lineStart = false;
+            currIndex += indentation;
+            continue;
+        }
+
+        switch (lookahead) {
+            //NEW LINE
+            case '\n':
+                if (lineHasTokens) tokens.push_back(makeOneSymbolToken(NEW_LINE, currIndex, 0, line));
+                lineHasTokens = false;
+                lineStart = true;
+                currIndex ++;
+                line ++;
+                if (line > MAX_LINES) {
+                    error() << "ERROR: Scripts are limited to " << MAX_LINES << " lines" << endl;
+                    throw ScriptError();
+                }
+                continue;
+
+            //COMMENT, memchr is vectorized by the C library
+            case '#': {
+                const void* end = memchr(data + currIndex, '\n', length - currIndex);
+                currIndex = end != nullptr ? static_cast<const char*>(end) - data : length;
+                continue;
+            }
+
+            //SPACE and SEMICOLON are ignored
+            case ' ':
+                currIndex = scanClass(data, currIndex, length, CHAR_SPACE);
+                continue;
+
+            case ';':
+                currIndex ++;
+                continue;
+        }
+
+        lineHasTokens = true;
+        int start = currIndex;
+
+        switch (lookahead) {
+            //COMMA
+            case ',':
+                tokens.push_back(makeOneSymbolToken(COMMA, start, 1, line));
+                currIndex ++;
+                continue;
+
+            //COLON
+            case ':':
+                tokens.push_back(makeOneSymbolToken(COLON, start, 1, line));
+                currIndex ++;
+                continue;
+
+            //EQUALS, and IS EQUAL operators
+            case '=':
+                if (currIndex + 1 < length && input[currIndex + 1] == '=') {
+                    tokens.push_back(makeOneSymbolToken(OPERATOR, start, 2, line));
+                    currIndex += 2;
+                } else {
+                    tokens.push_back(makeOneSymbolToken(EQUALS, start, 1, line));
+                    currIndex ++;
+                }
+                continue;
+
+            //GREATER, GREATER THAN, LESS and LESS THAN operators
+            case '>':
+            case '<':
+                if (currIndex + 1 < length && input[currIndex + 1] == '=') {
+                    tokens.push_back(makeOneSymbolToken(OPERATOR, start, 2, line));
+                    currIndex += 2;
+                } else {
+                    tokens.push_back(makeOneSymbolToken(OPERATOR, start, 1, line));
+                    currIndex ++;
+                }
+                continue;
+
+            //NOT_EQUAL operator
+            case '!':
+                if (currIndex + 1 < length && input[currIndex + 1] == '=') {
+                    tokens.push_back(makeOneSymbolToken(OPERATOR, start, 2, line));
+                    currIndex += 2;
+                    continue;
+                }
+                //'!' is only valid as part of "!=". The symbol at the reported position is the '!' itself, the character
+                //after it may be past the end of the input
+                error() << "ERROR: Invalid symbol ! at line " << line << " position " << start + firstPosition << endl;
+                throw ScriptError();
+
+            //PLUS
+            case '+':
+                tokens.push_back(makeOneSymbolToken(PLUS, start, 1, line));
+                currIndex ++;
+                continue;
+
+            //PARENTHESIS
+            case '(':
+                tokens.push_back(makeOneSymbolToken(OPEN_PARENTHESES, start, 1, line));
+                currIndex ++;
+                continue;
+
+            case ')':
+                tokens.push_back(makeOneSymbolToken(CLOSE_PARENTHESES, start, 1, line));
+                currIndex ++;
+                continue;
+
+            //BRACKETS
+            case '[':
+                tokens.push_back(makeOneSymbolToken(OPEN_BRACKET, start, 1, line));
+                currIndex ++;
+                continue;
+
+            case ']':
+                tokens.push_back(makeOneSymbolToken(CLOSE_BRACKET, start, 1, line));
+                currIndex ++;
+                continue;
+
+            //STRING
+            case '"': {
+                const void* quote = memchr(data + currIndex + 1, '"', length - currIndex - 1);
+                currIndex = (quote != nullptr ? static_cast<const char*>(quote) - data : length) + 1;
+                tokens.push_back(makeOneSymbolToken(STRING, start, min(currIndex, length) - start, line));
+                continue;
+            }
+        }
+
+        //INTEGER
+        if (CHARACTERS.is(lookahead, CHAR_DIGIT)) {
+            currIndex = scanClass(data, currIndex, length, CHAR_DIGIT);
+            tokens.push_back(makeOneSymbolToken(NUMBER, start, currIndex - start, line));
+            continue;
+        }
+
+        //IDENTIFIER
+        if (CHARACTERS.is(lookahead, CHAR_LETTER)) {
+            currIndex = scanClass(data, currIndex, length, CHAR_IDENTIFIER);
+            string_view identifier = input.substr(start, currIndex - start);
+
+            //check if identifier is a keyword
+            TokenType type = keywordType(identifier);
+
+            token identifierToken = makeOneSymbolToken(type, start, currIndex - start, line);
+            if (type == IDENTIFIER) identifierToken.symbol = stream.identifiers.intern(identifier);
+            tokens.push_back(identifierToken);
+            continue;
+        }
+
+        //ERROR
+        error() << "Error: Invalid character -> " << lookahead << " <- " << "at line " << line << " position " << start + firstPosition << endl;
+        throw ScriptError();
+    }
+
+    //Close last statement and all blocks still open
+    if (lineHasTokens) tokens.push_back(makeOneSymbolToken(NEW_LINE, length, 0, line));
+    for (int i = 1; i < (int)indentationStack.size(); i++) {
+        tokens.push_back(makeOneSymbolToken(BLOCK_END, length, 0, line));
+    }
+    tokens.push_back(makeOneSymbolToken(END_OF_FILE, length, 0, line));
+
+    //If DEBUGGING is on print out table with all tokens
+    if (DEBUG){
+        cout << "****************TOKENS****************" << endl;
+        cout << "LINES " << line << ". TOKENS: " << tokens.size() << " tokens found." << endl;
+        cout << "----------------------------------------------------------------------------" << endl;
+        cout << "Type               \t\tValue              \t\tLine\t\tPosition" << endl;
+        for (int i = 0; i < (int)tokens.size(); i++) {
+            string type = TOKEN_NAMES[tokens[i].type];
+            string value = string(tokenText(stream, tokens[i]));
+            type += string(19-min<size_t>(19, type.length()), ' ');
+            value += string(19-min<size_t>(19, value.length()), ' ');
+            cout << type << "\t\t" << value << "\t\t" << tokens[i].line << "\t\t" << tokens[i].offset + 1 << endl;
+        }
+    }
+
+    return stream;
+}
+
+//Helper function to create a token
+token makeOneSymbolToken(TokenType type, int offset, int length, int line) {
+    token t;
+    t.type = type;
+    t.offset = offset;
+    t.length = length;
+    t.line = line;
+    return t;
+}
+
+//Returns the text of a token as a view into the input buffer. Synthetic tokens (NEW_LINE, BLOCK_START...) return their type name
+string_view tokenText(const TokenStream& stream, const token& t) {
+    if (t.length == 0) return TOKEN_NAMES[t.type];
+    return stream.source.substr(t.offset, t.length);
+}
+
+
+//TREE PARSING
+AST parseTree(const TokenStream& stream) {
+    if (DEBUG) cout << "\n" << "****************TREE PARSING****************" << endl;
+
+    AST ast;
+    ast.nodes.reserve(stream.tokens.size() + 1); //Every node consumes at least one token
+    Parser parser = {stream, 0, ast, {}};
+
+    //create root node: <program>
+    ASTNode root = ASTNode();
+    root.type = AST_PROGRAM;
+    root.line = 1;
+
+    //Iterate through all statements in program
+    while (peek(parser).type != END_OF_FILE) {
+        parser.pending.push_back(parseStatement(parser)); //Add statement to root
+        if(DEBUG) cout << endl; //DEBUGGING
+    }
+    root.childList = ast.place(parser.pending, 0);
+    ast.place(root);
+
+    return ast; //Return AST
+}
+
+//Returns the token ahead of the cursor without consuming it
+const token& peek(Parser& parser, int ahead) {
+    const vector<token>& tokens = parser.stream.tokens;
+    int index = min(parser.cursor + ahead, (int)tokens.size() - 1);
+    return tokens[index];
+}
+
+//Consumes the token under the cursor
+const token& advance(Parser& parser) {
+    const token& current = peek(parser, 0);
+    if (parser.cursor < (int)parser.stream.tokens.size() - 1) parser.cursor ++;
+    return current;
+}
+
+//Consumes the token under the cursor, exits with an error if it is not of the expected type
+const token& expect(Parser& parser, TokenType type, const string& symbol) {
+    const token& current = peek(parser, 0);
+    if (current.type != type) {
+        error() << "ERROR: Expected " << symbol << " but found " << tokenText(parser.stream, current) << " at line: " << current.line << endl;
+        throw ScriptError();
+    }
+    return advance(parser);
+}
+
+//Places a single node in the arena as a list of one
+NodeList placeOne(Parser& parser, const ASTNode& node) {
+    int first = parser.pending.size();
+    parser.pending.push_back(node);
+    return parser.ast.place(parser.pending, first);
+}
+
+//Parses one statement and its trailing NEW_LINE. Function definitions and if statements consume their whole block
+ASTNode parseStatement(Parser& parser) {
+    token lookahead = peek(parser); //Tokens are small, copying one is cheaper than tracking a reference
+
+    //<FUNCTION_DEFINITION>
+    if (lookahead.type == FUNCTION_DEFINITION) {
+        if (DEBUG) cout << "<DEF>";
+        advance(parser);
+
+        ASTNode function = ASTNode();
+        function.type = AST_FUNCTION;
+        function.line = lookahead.line;
+        function.symbol = tokenText(parser.stream, expect(parser, IDENTIFIER, "function name"));
+
+        //Get parameters
+        int first = parser.pending.size();
+        expect(parser, OPEN_PARENTHESES, "(");
+        while (peek(parser).type != CLOSE_PARENTHESES) {
+            const token& name = expect(parser, IDENTIFIER, "parameter name");
+            ASTNode parameter = ASTNode();
+            parameter.type = AST_PARAMETER;
+            parameter.symbol = tokenText(parser.stream, name);
+            parameter.line = name.line;
+            parser.pending.push_back(parameter);
+            if (peek(parser).type == COMMA) advance(parser);
+        }
+        function.parameterList = parser.ast.place(parser.pending, first);
+        advance(parser);
+        expect(parser, COLON, ":");
+        if (DEBUG) cout << "<COLON>" << endl;
+
+        function.childList = parseBlock(parser);
+        return function;
+    }
+
+    //<IF>
+    if (lookahead.type == IF) {
+        if (DEBUG) cout << "<IF>";
+        advance(parser);
+
+        ASTNode ifStatement = ASTNode();
+        ifStatement.type = AST_IF;
+        ifStatement.symbol = "if";
+        ifStatement.line = lookahead.line;
+
+        ifStatement.parameterList = placeOne(parser, parseExpression(parser));
+        expect(parser, COLON, ":");
+        if (DEBUG) cout << "<COLON>" << endl;
+        ifStatement.childList = parseBlock(parser);
+
+        //If next token is Else, its block is the else branch, kept apart from the then branch so each one only runs
+        //when it is taken
+        lookahead = peek(parser);
+        if (lookahead.type == ELSE) {
+            if (DEBUG) cout << "<ELSE>";
+            advance(parser);
+            expect(parser, COLON, ":");
+            if (DEBUG) cout << "<COLON>" << endl;
+            ifStatement.expressionList = parseBlock(parser);
+        }
+
+        return ifStatement;
+    }
+
+    ASTNode statement = ASTNode();
+
+    //<RETURN>
+    if (lookahead.type == RETURN) {
+        if (DEBUG) cout << "<RETURN>";
+        advance(parser);
+
+        statement.type = AST_RETURN;
+        statement.line = lookahead.line;
+        statement.expressionList = placeOne(parser, parseExpression(parser));
+    }
+
+    //<IDENTIFIER><EQUALS>
+    else if (lookahead.type == IDENTIFIER && peek(parser, 1).type == EQUALS) {
+        if (DEBUG) cout << "<IDENTIFIER><EQUALS>";
+        advance(parser);
+        advance(parser);
+
+        statement.type = AST_ASSIGMENT;
+        statement.symbol = parser.stream.identifiers.names[lookahead.symbol];
+        statement.line = lookahead.line;
+        statement.expressionList = placeOne(parser, parseExpression(parser));
+    }
+
+    //<EXPRESSION>
+    else {
+        statement = parseExpression(parser);
+
+        //<LIST_INDEX><EQUALS>
+        if (peek(parser).type == EQUALS) {
+            if (statement.type != AST_LIST_INDEX) {
+                error() << "ERROR: Invalid assigment at line: " << peek(parser).line << endl;
+                throw ScriptError();
+            }
+            if (DEBUG) cout << "<EQUALS>";
+            advance(parser);
+
+            ASTNode listIndex = statement;
+            listIndex.expressionList = placeOne(parser, parseExpression(parser));
+
+            statement = ASTNode();
+            statement.type = AST_ASSIGMENT;
+            statement.symbol = listIndex.symbol;
+            statement.line = listIndex.line;
+            statement.expressionList = placeOne(parser, listIndex);
+        }
+    }
+
+    //Statement has to finish at the end of the line
+    if (peek(parser).type != END_OF_FILE) expect(parser, NEW_LINE, "end of line");
+    return statement;
+}
+
+//<BLOCK> -> <NEW_LINE><BLOCK_START> <STATEMENT>* <BLOCK_END>
+NodeList parseBlock(Parser& parser) {
+    int first = parser.pending.size();
+    expect(parser, NEW_LINE, "end of line");
+    expect(parser, BLOCK_START, "indented block");
+    while (peek(parser).type != BLOCK_END && peek(parser).type != END_OF_FILE) {
+        parser.pending.push_back(parseStatement(parser));
+    }
+    advance(parser);
+    return parser.ast.place(parser.pending, first);
+}
+
+//Creates an operation node and places its two terms in the arena
+ASTNode makeOperation(Parser& parser, const token& op, string_view value, const ASTNode& left, const ASTNode& right) {
+    ASTNode operation = ASTNode();
+    operation.type = AST_OPERATION;
+    operation.line = op.line;
+    operation.value = value;
+
+    int first = parser.pending.size();
+    parser.pending.push_back(left);
+    parser.pending.push_back(right);
+    operation.parameterList = parser.ast.place(parser.pending, first);
+    return operation;
+}
+
+//<EXPRESSION> -> <SUM> (<OPERATOR> <SUM>)?
+ASTNode parseExpression(Parser& parser) {
+    ASTNode left = parseSum(parser);
+
+    if (peek(parser).type != OPERATOR) return left;
+
+    const token& lookahead = advance(parser);
+    if (DEBUG) cout << "<OPERATOR>";
+
+    return makeOperation(parser, lookahead, tokenText(parser.stream, lookahead), left, parseSum(parser));
+}
+
+//<SUM> -> <TERM> (<PLUS> <TERM>)*
+ASTNode parseSum(Parser& parser) {
+    ASTNode left = parseTerm(parser);
+
+    while (peek(parser).type == PLUS) {
+        const token& lookahead = advance(parser);
+        if (DEBUG) cout << "<PLUS>";
+
+        left = makeOperation(parser, lookahead, "+", left, parseTerm(parser));
+    }
+    return left;
+}
+
+//Parses a comma separated list of expressions until the closing token
+NodeList parseArguments(Parser& parser, TokenType closeType, const string& closeSymbol) {
+    int first = parser.pending.size();
+    while (peek(parser).type != closeType) {
+        parser.pending.push_back(parseExpression(parser));
+        if (peek(parser).type != COMMA) break;
+        advance(parser);
+    }
+    expect(parser, closeType, closeSymbol);
+    return parser.ast.place(parser.pending, first);
+}
+
+//<TERM> -> <NUMBER> | <STRING> | <BOOLEAN> | <NULL> | <IDENTIFIER> | <FUNCTION_CALL> | <LIST_INDEX> | <LIST> | (<EXPRESSION>*) | <PRINT> | <LENGTH>
+ASTNode parseTerm(Parser& parser) {
+    const token& lookahead = advance(parser);
+    ASTNode statement = ASTNode();
+    statement.line = lookahead.line;
+
+    //<IDENTIFIER>
+    if (lookahead.type == IDENTIFIER) {
+        statement.symbol = parser.stream.identifiers.names[lookahead.symbol];
+
+        //<IDENTIFIER><OPEN_PARENTHESIS>
+        if (peek(parser).type == OPEN_PARENTHESES) {
+            if (DEBUG) cout << "<FUNCTION_CALL>";
+            advance(parser);
+            statement.type = AST_FUNCTION_CALL;
+            statement.parameterList = parseArguments(parser, CLOSE_PARENTHESES, ")");
+            return statement;
+        }
+
+        //<IDENTIFIER><OPEN_BRACKET>
+        if (peek(parser).type == OPEN_BRACKET) {
+            if (DEBUG) cout << "<LIST_INDEX>";
+            advance(parser);
+            statement.type = AST_LIST_INDEX;
+            statement.parameterList = placeOne(parser, parseExpression(parser));
+            expect(parser, CLOSE_BRACKET, "]");
+            return statement;
+        }
+
+        if (DEBUG) cout << "<IDENTIFIER>";
+        statement.type = AST_IDENTIFIER;
+        return statement;
+    }
+
+    //<NUMBER>
+    if (lookahead.type == NUMBER) {
+        if (DEBUG) cout << "<NUMBER>";
+        statement.type = AST_NUMBER;
+        statement.value = tokenText(parser.stream, lookahead);
         return statement;
     }
 
     //<STRING>
-    //If token is a string
     if (lookahead.type == STRING) {
         if (DEBUG) cout << "<STRING>";
-
         statement.type = AST_STRING;
-        statement.value = lookahead.value;
-        statement.line = lookahead.line;
+        statement.value = tokenText(parser.stream, lookahead).substr(1, max(0, lookahead.length - 2)); //Remove quotes
+        return statement;
+    }
 
+    //<BOOLEAN>
+    if (lookahead.type == TRUE || lookahead.type == FALSE) {
+        if (DEBUG) cout << "<BOOLEAN>";
+        statement.type = AST_BOOLEAN;
+        statement.value = lookahead.type == TRUE ? "true" : "false";
         return statement;
     }
 
-    //<BOOLEAN>
-    //If token is a boolean
-    if (lookahead.type == TRUE || lookahead.type == FALSE) {
-        if (DEBUG) cout << "<BOOLEAN>";
+    //<NULL>
+    if (lookahead.type == NULL_IDENTIFIER) {
+        if (DEBUG) cout << "<NULL>";
+        statement.type = AST_NULL;
+        statement.value = tokenText(parser.stream, lookahead);
+        return statement;
+    }
+
+    //<OPEN BRACKET>
+    if (lookahead.type == OPEN_BRACKET) {
+        if (DEBUG) cout << "<LIST>";
+        statement.type = AST_LIST;
+        statement.expressionList = parseArguments(parser, CLOSE_BRACKET, "]");
+        return statement;
+    }
+
+    //<OPEN_PARENTHESIS>
+    if (lookahead.type == OPEN_PARENTHESES) {
+        if (DEBUG) cout << "<EXPRESSION>";
+        statement.type = AST_EXPRESSION;
+        statement.expressionList = parseArguments(parser, CLOSE_PARENTHESES, ")");
+        return statement;
+    }
+
+    //<PRINT> and <LENGTH>
+    //Arguments are stored as a parenthesized expression
+    if (lookahead.type == PRINT || lookahead.type == LENGTH) {
+        if (DEBUG) cout << "<" << TOKEN_NAMES[lookahead.type] << ">";
+        statement.type = AST_BUILTIN;
+        statement.builtin = lookahead.type == PRINT ? BUILTIN_PRINT : BUILTIN_LEN;
+        statement.symbol = tokenText(parser.stream, lookahead);
+        if (peek(parser).type != OPEN_PARENTHESES) expect(parser, OPEN_PARENTHESES, "(");
+        statement.expressionList = placeOne(parser, parseTerm(parser));
+        return statement;
+    }
+
+    error() << "ERROR: Unexpected " << tokenText(parser.stream, lookahead) << " at line: " << lookahead.line << endl;
+    throw ScriptError();
+}
+
+//DEBUGGING
+void printASTTree(const ASTNode& node, int tabs) {
+    string tabulations = "";
+    for (int i = 0; i < tabs; i++) {
+        tabulations += "\t";
+    }
+    cout << tabulations <<"Type: " << AST_NAMES[node.type] << "-> Symbol: " << node.symbol << ". -> Value: " << node.value << endl;
+    if (node.children().size() > 0) {
+        cout << tabulations << "Child " << endl;
+        for (int i = 0; i < node.children().size(); i++) {
+            printASTTree(node.children()[i], tabs + 1);
+        }
+    }
+    if(node.expression().size() > 0) {
+        cout << tabulations << "Expression " << endl;
+        for (int i = 0; i < node.expression().size(); i++) {
+            printASTTree(node.expression()[i], tabs + 1);
+        }
+    } 
+    if (node.parameters().size() > 0) {
+        cout << tabulations << "Parameter " << endl;
+        for (int i = 0; i < node.parameters().size(); i++) {
+            printASTTree(node.parameters()[i], tabs + 1);
+        }
+    }
+}
+
+//VALUES
+//Helper functions to create values
+Value makeNumber(int integer) {
+    Value value;
+    value.type = VALUE_NUMBER;
+    value.integer = integer;
+    return value;
+}
+
+Value makeBoolean(bool boolean) {
+    Value value;
+    value.type = VALUE_BOOLEAN;
+    value.boolean = boolean;
+    return value;
+}
+
+Value makeNull() {
+    Value value;
+    value.type = VALUE_NULL;
+    return value;
+}
+
+Value makeString(string_view str) {
+    StringObject* object = new StringObject();
+    object->str = string(str);
+    object->references = 1;
+    Value value;
+    value.type = VALUE_STRING;
+    value.object = object;
+    return value;
+}
+
+//List of size elements, the caller sets them
+Value makeList(int size) {
+    ListObject* object = ListObject::create(size);
+    object->references = 1;
+    Value value;
+    value.type = VALUE_LIST;
+    value.object = object;
+    return value;
+}
+
+Value copyList(const ListObject& list) {
+    Value copy = makeList(list.size);
+    memcpy(copy.list().begin(), list.begin(), list.size * sizeof(int));
+    return copy;
+}
+
+//Returns a list for writing, it is copied first if other values share it (copy on write)
+ListObject& writableList(Value& value) {
+    if (value.object->references > 1) value = copyList(value.list());
+    return value.list();
+}
+
+//Both lists are copied with one allocation of the final size
+Value concatenate(const ListObject& list1, const ListObject& list2) {
+    Value result = makeList(list1.size + list2.size);
+    memcpy(result.list().begin(), list1.begin(), list1.size * sizeof(int));
+    memcpy(result.list().begin() + list1.size, list2.begin(), list2.size * sizeof(int));
+    return result;
+}
+
+Value makeFunction(const ASTNode* function) {
+    Value value;
+    value.type = VALUE_FUNCTION;
+    value.function = function;
+    return value;
+}
+
+Value makeUndefined() {
+    Value value;
+    value.type = VALUE_UNDEFINED;
+    return value;
+}
+
+//Operator of an AST_OPERATION node
+Operator operatorOf(string_view symbol) {
+    if (symbol == "+") return OPERATOR_ADD;
+    if (symbol == "==") return OPERATOR_EQUAL;
+    if (symbol == ">") return OPERATOR_GREATER;
+    if (symbol == "<") return OPERATOR_LESS;
+    if (symbol == ">=") return OPERATOR_GREATER_EQUAL;
+    if (symbol == "<=") return OPERATOR_LESS_EQUAL;
+    if (symbol == "!=") return OPERATOR_NOT_EQUAL;
+    return OPERATOR_UNKNOWN;
+}
+
+//Evaluates a binary operation. Shared by the tree walker and the virtual machine so both engines behave the same
+Value operate(Operator op, const Value& term1, const Value& term2, int line) {
+    if (term1.type != term2.type) {
+        error() << "ERROR: cannot operate " << VALUE_NAMES[term1.type] << " with " << VALUE_NAMES[term2.type] << ". At line: " << line << endl;
+        throw ScriptError();
+    }
+
+    switch (op) {
+        //SUM
+        case OPERATOR_ADD:
+            if (term1.type == VALUE_LIST) return concatenate(term1.list(), term2.list());
+            if (term1.type == VALUE_STRING) {
+                return makeString(term1.str() + term2.str());
+            }
+            return makeNumber(term1.integer + term2.integer);
+
+        //COMPARISON
+        case OPERATOR_EQUAL: return makeBoolean(equalValues(term1, term2));
+
+        //DIFFERENT
+        case OPERATOR_NOT_EQUAL: return makeBoolean(!equalValues(term1, term2));
+
+        //GREATER THAN
+        case OPERATOR_GREATER: return makeBoolean(compareValues(term1, term2, line) > 0);
+
+        //LESS THAN
+        case OPERATOR_LESS: return makeBoolean(compareValues(term1, term2, line) < 0);
+
+        //GREATER THAN OR EQUAL
+        case OPERATOR_GREATER_EQUAL: return makeBoolean(compareValues(term1, term2, line) >= 0);
 
-        statement.type = AST_BOOLEAN;
-        statement.line = lookahead.line;
-        statement.value = lookahead.value;
+        //LESS THAN OR EQUAL
+        case OPERATOR_LESS_EQUAL: return makeBoolean(compareValues(term1, term2, line) <= 0);
 
-        return statement;
+        default:
+            error() << "ERROR: Operation not implemented at line: " << line << endl;
+            throw ScriptError();
     }
+}
 
-    //<NULL>
-    //If token is null
-    if (lookahead.type == NULL_IDENTIFIER) {
-        if (DEBUG) cout << "<NULL>";
+//== on two values of the same type. Strings and lists compare their contents, null is never equal to anything
+bool equalValues(const Value& term1, const Value& term2) {
+    switch (term1.type) {
+        case VALUE_NUMBER: return term1.integer == term2.integer;
+        case VALUE_BOOLEAN: return term1.boolean == term2.boolean;
+        case VALUE_STRING: return term1.str() == term2.str();
+        case VALUE_LIST: {
+            const ListObject& list1 = term1.list();
+            const ListObject& list2 = term2.list();
+            return list1.size == list2.size && equal(list1.begin(), list1.end(), list2.begin());
+        }
+        case VALUE_FUNCTION: return term1.function == term2.function;
+        default: return false;
+    }
+}
 
-        statement.type = AST_NULL;
-        statement.line = lookahead.line;
-        statement.value = lookahead.value;
+//Orders two values of the same type: negative, 0 or positive. Strings and lists compare element by element like
+//Python does, other types cannot be ordered
+int compareValues(const Value& term1, const Value& term2, int line) {
+    switch (term1.type) {
+        case VALUE_NUMBER: return (term1.integer > term2.integer) - (term1.integer < term2.integer);
+        case VALUE_BOOLEAN: return term1.boolean - term2.boolean;
+        case VALUE_STRING: return term1.str().compare(term2.str());
+        case VALUE_LIST: {
+            const ListObject& list1 = term1.list();
+            const ListObject& list2 = term2.list();
+            auto difference = mismatch(list1.begin(), list1.end(), list2.begin(), list2.end());
+            if (difference.first != list1.end() && difference.second != list2.end()) {
+                return (*difference.first > *difference.second) - (*difference.first < *difference.second);
+            }
+            return (list1.size > list2.size) - (list1.size < list2.size);
+        }
+        default:
+            error() << "ERROR: cannot order " << VALUE_NAMES[term1.type] << " values at line: " << line << endl;
+            throw ScriptError();
+    }
+}
 
-        return statement;
+//Fast path of the integer operation kinds, both terms are numbers
+Value operateIntegers(OperationKind kind, int integer1, int integer2) {
+    switch (kind) {
+        case OPERATION_ADD_INT: return makeNumber(integer1 + integer2);
+        case OPERATION_EQUAL_INT: return makeBoolean(integer1 == integer2);
+        case OPERATION_NOT_EQUAL_INT: return makeBoolean(integer1 != integer2);
+        case OPERATION_LESS_INT: return makeBoolean(integer1 < integer2);
+        case OPERATION_LESS_EQUAL_INT: return makeBoolean(integer1 <= integer2);
+        case OPERATION_GREATER_INT: return makeBoolean(integer1 > integer2);
+        default: return makeBoolean(integer1 >= integer2);
     }
+}
 
-    //<PRINT>
-    //If token is print
-    if (lookahead.type == PRINT) {
-        if (DEBUG) cout << "<PRINT>";
+//Prints one argument of print(), numbers strings and lists are followed by a space
+void printValue(const Value& value) {
+    if (value.type == VALUE_NUMBER) {
+        output.writeInteger(value.integer);
+        output.put(' ');
+    }
+    if (value.type == VALUE_STRING) {
+        output.write(value.str());
+        output.put(' ');
+    }
+    if (value.type == VALUE_LIST) {
+        ListObject& list = value.list();
+        output.put('[');
+        for (int i=0; i<list.size; i++) {
+            output.writeInteger(list[i]);
+            if (i != list.size - 1) output.write(", ");
+        }
+        output.write("] ");
+    }
+}
 
-        ASTNode print = ASTNode();
-        print.type = AST_FUNCTION_CALL;
-        print.symbol = lookahead.value;
-        print.line = lookahead.line;
+//Truth value of conditions
+bool isTrue(const Value& value) {
+    if (value.type == VALUE_BOOLEAN) return value.boolean;
+    if (value.type == VALUE_NUMBER) return value.integer != 0;
+    if (value.type == VALUE_STRING) return !value.str().empty();
+    if (value.type == VALUE_LIST) return value.list().size > 0;
+    return false;
+}
 
-        print.expression.push_back(parseStatement(tokens, line, tokenIndex+1, tokens[line][tokenIndex+1]));
-        return print;
+//RESOLVER
+//Binds every variable name in the AST to a slot, so the interpreter indexes an array instead of hashing names.
+//Inside a function, parameters and every name assigned in its body are locals of its call frame, other names are globals.
+void resolve(ASTNode& node, unordered_map<string_view, int>* locals) {
+    if (node.type == AST_ASSIGMENT || node.type == AST_IDENTIFIER || node.type == AST_LIST_INDEX || node.type == AST_FUNCTION
+        || node.type == AST_PARAMETER || node.type == AST_FUNCTION_CALL) {
+        auto local = locals != nullptr ? locals->find(node.symbol) : unordered_map<string_view, int>::iterator();
+        if (locals != nullptr && local != locals->end()) {
+            node.local = true;
+            node.slot = local->second;
+        } else {
+            node.slot = environment.declare(string(node.symbol));
+        }
     }
 
-    //<LENGTH>
-    if (lookahead.type == LENGTH) {
-        if (DEBUG) cout << "<LENGTH>";
-
-        ASTNode length = ASTNode();
-        length.type = AST_FUNCTION_CALL;
-        length.line = lookahead.line;
-        length.symbol = lookahead.value;
+    if (node.type == AST_FUNCTION) {
+        //Parameters take the first slots of the frame, then every name assigned in the body
+        unordered_map<string_view, int> functionLocals;
+        for (ASTNode& parameter : node.parameters()) {
+            functionLocals.emplace(parameter.symbol, functionLocals.size());
+        }
+        for (const ASTNode& child : node.children()) declareLocals(child, functionLocals);
+        node.frameSize = functionLocals.size();
 
-        length.expression.push_back(parseStatement(tokens, line, tokenIndex+1, tokens[line][tokenIndex+1]));
-        return length;
+        for (ASTNode& parameter : node.parameters()) resolve(parameter, &functionLocals);
+        for (ASTNode& child : node.children()) resolve(child, &functionLocals);
+        return;
     }
 
-    //<IF>
-    if (lookahead.type == IF) {
-        if (DEBUG) cout << "<IF>";
+    for (ASTNode& child : node.children()) resolve(child, locals);
+    for (ASTNode& parameter : node.parameters()) resolve(parameter, locals);
+    for (ASTNode& expression : node.expression()) resolve(expression, locals);
+}
 
-        ASTNode ifStatement = ASTNode();
-        ifStatement.type = AST_FUNCTION_CALL;
-        ifStatement.symbol = lookahead.value;
-        ifStatement.line = lookahead.line;
+//Adds the names assigned by a statement of a function body to its locals. Nested function bodies have their own scope
+void declareLocals(const ASTNode& node, unordered_map<string_view, int>& locals) {
+    bool listIndexAssigment = node.type == AST_ASSIGMENT && node.expression().size() > 0 && node.expression()[0].type == AST_LIST_INDEX;
+    if ((node.type == AST_ASSIGMENT && !listIndexAssigment) || node.type == AST_FUNCTION) {
+        locals.emplace(node.symbol, locals.size());
+    }
+    if (node.type == AST_FUNCTION) return;
 
-        ifStatement.parameters.push_back(parseStatement(tokens, line, tokenIndex+1, tokens[line][tokenIndex+1]));
+    for (const ASTNode& child : node.children()) declareLocals(child, locals);
+    for (const ASTNode& expression : node.expression()) declareLocals(expression, locals);
+}
 
-        //Check for colon and new line
-        int tokenIncrement = 2;
-        for (int i = tokenIndex+tokenIncrement; i<tokens[line].size(); i++) {
-            lookahead = tokens[line][i];
-            if (lookahead.type == COLON) {
-                if (DEBUG) cout << "<COLON>" << endl;
-                break;
-            } else if (i == tokens[line].size() - 1) {
-                cout << "ERROR: Missing colon after if statement at line: " << lookahead.line << endl;
-                exit(1);
-            }
-        }
-        
-        //Add as childs next lines until end block found
-        line ++;
-        lookahead = tokens[line][tokenIndex];
-        while (lookahead.type != BLOCK_END) {
-            linesToSkip ++;
-            ASTNode statement = parseStatement(tokens, line, tokenIndex, lookahead);
-            ifStatement.children.push_back(statement);
-            token lastElement = tokens[line][tokens[line].size()-1];
-            line += 1 + statement.children.size();
-            if (lastElement.type == BLOCK_END) {
-                if (DEBUG) cout << endl;
-                break;
-            }
-            lookahead = tokens[line][tokenIndex];
-        }
-        
-        //If next token is Else, add else as expression
-        lookahead = tokens[line][tokenIndex];
-        if (lookahead.type == ELSE) {
-            if (DEBUG) cout << "<ELSE>";
-            ASTNode elseStatement = ASTNode();
-            elseStatement.type = AST_FUNCTION_CALL;
-            elseStatement.line = lookahead.line;
-            elseStatement.symbol = lookahead.value;
+//Reads the value of a number literal or of a variable holding a number, returns false for any other node
+bool integerOf(const ASTNode& node, int& integer) {
+    if (node.type == AST_NUMBER) {
+        integer = node.integer;
+        return true;
+    }
+    if (node.type == AST_IDENTIFIER) {
+        const Value& value = variable(node);
+        integer = value.integer;
+        return value.type == VALUE_NUMBER;
+    }
+    return false;
+}
 
-            if (tokens[line][tokenIndex+1].type != COLON) {
-                cout << "ERROR: Missing colon after else statement at line: " << lookahead.line << endl;
-                exit(1);
-            }
-            if (DEBUG) cout <<"<COLON>" << endl;
-
-            line ++;
-            linesToSkip ++;
-            lookahead = tokens[line][tokenIndex];
-            while (lookahead.type != BLOCK_END) {
-                linesToSkip ++;
-                if(line > tokens.size()) break;
-                ASTNode statement = parseStatement(tokens, line, tokenIndex, lookahead);
-                elseStatement.children.push_back(statement);
-                token lastElement = tokens[line][tokens[line].size()-1];
-                line += 1 + statement.children.size();
-                if (lastElement.type == BLOCK_END) break;
-                if (tokens.size() > line) {
-                    lookahead = tokens[line][tokenIndex];
-                }
-            }
+//Slow path of a call whose inline cache missed, shared by both engines: stops the script if the callee is not a function
+//of arguments parameters, otherwise caches it
+void checkCall(const Value& callee, const ASTNode& call, int arguments, const ASTNode*& cache) {
+    if (callee.type == VALUE_UNDEFINED) {
+        error() << "ERROR: Function " << call.symbol << " not found at line: " << call.line << endl;
+        throw ScriptError();
+    }
+    if (callee.type != VALUE_FUNCTION) {
+        error() << "ERROR: " << call.symbol << " is not a function at line: " << call.line << endl;
+        throw ScriptError();
+    }
+    const ASTNode& function = *callee.function;
+    if (arguments != function.parameters().size()) {
+        error() << "ERROR: Function " << function.symbol << " expects " << function.parameters().size() << " arguments at line: " << call.line << endl;
+        throw ScriptError();
+    }
+    cache = &function;
+}
 
-            ifStatement.children.push_back(elseStatement);
-        }
-        
-        return ifStatement;
+//Integer stored in a list or used as an index: numbers, and booleans as 0 or 1. Any other value stops the script
+int listInteger(const Value& value, const char* message, int line) {
+    if (value.type == VALUE_NUMBER) return value.integer;
+    if (value.type == VALUE_BOOLEAN) return value.boolean;
+    error() << "ERROR: " << message << " at line: " << line << endl;
+    throw ScriptError();
+}
+
+//Checks an indexing of the variable named by node, shared by both engines: the variable has to hold a list and the
+//index has to be a number inside it. Returns the index
+int checkIndex(const Value& list, const Value& index, const ASTNode& node) {
+    if (list.type == VALUE_UNDEFINED) {
+        error() << "ERROR: Variable " << node.symbol << " not found at line: " << node.line << endl;
+        throw ScriptError();
     }
+    if (list.type != VALUE_LIST) {
+        error() << "ERROR: Variable " << node.symbol << " is not a list at line: " << node.line << endl;
+        throw ScriptError();
+    }
+    int position = listInteger(index, "List index must be a number", node.line);
+    if (position < 0 || position >= list.list().size) {
+        error() << "ERROR: List index out of range at line: " << node.line << endl;
+        throw ScriptError();
+    }
+    return position;
+}
 
-    //<FUNCTION_DEFINITION>
-    if (lookahead.type == FUNCTION_DEFINITION) {
-        if (DEBUG) cout << "<DEF>";
+//Returns the storage of the variable named by a resolved node
+Value& variable(const ASTNode& node) {
+    if (node.local) return callStack.top().locals[node.slot];
+    return environment.global(node.slot);
+}
 
-        ASTNode function = ASTNode();
-        function.type = AST_FUNCTION;
-        function.line = lookahead.line;
+//OPTIMIZER
+//Runs after the resolver. Decodes number and boolean literals once, folds operations on literals into a single literal
+//and removes the branch of an if statement that can never run. Folded nodes keep their old children in the arena unused
+void optimize(AST& ast, ASTNode& node) {
+    for (ASTNode& child : node.children()) optimize(ast, child);
+    for (ASTNode& parameter : node.parameters()) optimize(ast, parameter);
+    for (ASTNode& expression : node.expression()) optimize(ast, expression);
 
-        //Get funcion name
-        int tokenIncrement = 1;
-        lookahead = tokens[line][tokenIndex+tokenIncrement];
-        if (lookahead.type != IDENTIFIER) {
-            cout << "ERROR: no name found for function defnition at line: " << lookahead.line << endl;
-            exit(1);
+    //Number literals that do not fit in an int stop the script when it is loaded, even in code that never runs
+    if (node.type == AST_NUMBER) {
+        const char* end = node.value.data() + node.value.size();
+        from_chars_result decoded = from_chars(node.value.data(), end, node.integer);
+        if (decoded.ec != errc() || decoded.ptr != end) {
+            error() << "ERROR: Number " << node.value << " out of range at line: " << node.line << endl;
+            throw ScriptError();
         }
-        function.symbol = lookahead.value;
+    }
+    if (node.type == AST_BOOLEAN) node.integer = node.value == "true";
 
-        //Get parameters
-        tokenIncrement ++;
-        lookahead = tokens[line][tokenIndex+tokenIncrement];
-        while (lookahead.type != COLON) {
-            if (lookahead.type == IDENTIFIER) {
-                ASTNode parameter = ASTNode();
-                parameter.type = AST_PARAMETER;
-                parameter.symbol = lookahead.value;
-                parameter.line = lookahead.line;
-                function.parameters.push_back(parameter);
-            } else if (lookahead.type == OPEN_PARENTHESES) {
-                if (DEBUG) cout << "<OPEN_PARENTHESES>";
-            } else if (lookahead.type == CLOSE_PARENTHESES) {
-                if (DEBUG) cout << "<OPEN_PARENTHESES>";
-            }
-            tokenIncrement ++;
-            lookahead = tokens[line][tokenIndex+tokenIncrement];
+    //A list of number and boolean literals is built once here, evaluating it shares the list instead of building it
+    if (node.type == AST_LIST) {
+        bool constant = true;
+        for (const ASTNode& element : node.expression()) {
+            const ASTNode* literal = literalOf(element);
+            constant = constant && literal != nullptr && literal->type != AST_STRING;
         }
-        if (DEBUG) cout << "<COLON>" << endl;
-        
-        line ++;
-        linesToSkip ++;
-        lookahead = tokens[line][tokenIndex];
-        while (lookahead.type != BLOCK_END) {
-            linesToSkip ++;
-            ASTNode funcStatement = parseStatement(tokens, line, tokenIndex, lookahead);
-            function.children.push_back(funcStatement);
-            token lastElement = tokens[line][tokens[line].size()-1];
-            line += 1 + funcStatement.children.size();
-            if (lastElement.type == BLOCK_END) break;
-            if (tokens.size() > line) {
-                lookahead = tokens[line][tokenIndex];
-            }
+        if (constant) {
+            Value list = makeList(node.expression().size());
+            for (int i = 0; i < node.expression().size(); i++) list.list()[i] = literalOf(node.expression()[i])->integer;
+            ast.lists.push_back(move(list));
+            node.constant = &ast.lists.back();
         }
-        return function;
     }
 
-    //<BLOCK_END>
-    if (lookahead.type == BLOCK_END) {
-        if (tokens[line].size() > 1) {
-            return parseStatement(tokens, line, tokenIndex+1, tokens[line][tokenIndex+1]);
+    if (node.type == AST_OPERATION) {
+        const ASTNode* term1 = literalOf(node.parameters()[0]);
+        const ASTNode* term2 = literalOf(node.parameters()[1]);
+        Operator op = operatorOf(node.value);
+
+        //Mismatched types and unknown operators are left for the interpreter, they are only errors if the line runs
+        bool foldable = term1 != nullptr && term2 != nullptr && term1->type == term2->type && op != OPERATOR_UNKNOWN;
+        if (foldable) {
+            makeLiteral(ast, node, operate(op, literalValue(*term1), literalValue(*term2), node.line));
         } else {
-            return ASTNode();
+            node.operation = operationKind(op, node.parameters()[0], node.parameters()[1]);
         }
     }
 
-    //<RETURN>
-    if (lookahead.type == RETURN) {
-        if (DEBUG) cout << "<RETURN>";
+    //A constant condition turns the if statement into an unconditional block holding the branch that runs
+    if (node.type == AST_IF) {
+        const ASTNode* condition = literalOf(node.parameters()[0]);
+        if (condition == nullptr) return;
 
-        ASTNode returnNode = ASTNode();
-        returnNode.type = AST_RETURN;
-        returnNode.line = lookahead.line;
+        if (!isTrue(literalValue(*condition))) node.childList = node.expressionList;
+        node.type = AST_BLOCK;
+        node.symbol = "";
+        node.parameterList = NodeList();
+        node.expressionList = NodeList();
+    }
+}
 
-        lookahead = tokens[line][tokenIndex+1];
-        returnNode.expression.push_back(parseStatement(tokens, line, tokenIndex+1, lookahead));
+//Chooses the kind of an operation that was not folded. Only literal terms have a known type: a string or list literal
+//makes + and == generic (or a list concatenation), otherwise the terms are expected to be numbers. Comparisons other
+//than == only compare integers in operate() too
+OperationKind operationKind(Operator op, const ASTNode& term1, const ASTNode& term2) {
+    const ASTNode* literal1 = literalOf(term1);
+    const ASTNode* literal2 = literalOf(term2);
+    bool strings = (literal1 != nullptr && literal1->type == AST_STRING) || (literal2 != nullptr && literal2->type == AST_STRING);
+    bool lists = term1.type == AST_LIST || term2.type == AST_LIST;
+    bool nulls = term1.type == AST_NULL || term2.type == AST_NULL;
+
+    switch (op) {
+        case OPERATOR_ADD:
+            if (lists) return OPERATION_CONCAT_LIST;
+            return strings ? OPERATION_GENERIC : OPERATION_ADD_INT;
+        case OPERATOR_EQUAL: return strings || lists || nulls ? OPERATION_GENERIC : OPERATION_EQUAL_INT;
+        case OPERATOR_NOT_EQUAL: return OPERATION_NOT_EQUAL_INT;
+        case OPERATOR_LESS: return OPERATION_LESS_INT;
+        case OPERATOR_LESS_EQUAL: return OPERATION_LESS_EQUAL_INT;
+        case OPERATOR_GREATER: return OPERATION_GREATER_INT;
+        case OPERATOR_GREATER_EQUAL: return OPERATION_GREATER_EQUAL_INT;
+        default: return OPERATION_GENERIC;
+    }
+}
 
-        if (DEBUG) cout << endl;
+//Returns the literal a node evaluates to, looking through parentheses, or nullptr if it is not constant
+const ASTNode* literalOf(const ASTNode& node) {
+    if (node.type == AST_NUMBER || node.type == AST_STRING || node.type == AST_BOOLEAN) return &node;
+    if (node.type == AST_EXPRESSION && node.expression().size() == 1) return literalOf(node.expression()[0]);
+    return nullptr;
+}
 
-        return returnNode;
-    }
-    
-    ASTNode error = ASTNode();
-    error.type = AST_ERROR;
-    error.value = "Unrecognized statement";
-    return error;
+//Value of a decoded literal node
+Value literalValue(const ASTNode& node) {
+    if (node.type == AST_NUMBER) return makeNumber(node.integer);
+    if (node.type == AST_BOOLEAN) return makeBoolean(node.integer);
+    return makeString(node.value);
 }
 
-//DEBUGGING
-void printASTTree(ASTNode node, int tabs) {
-    string tabulations = "";
-    for (int i = 0; i < tabs; i++) {
-        tabulations += "\t";
-    }
-    cout << tabulations <<"Type: " << node.type << "-> Symbol: " << node.symbol << ". -> Value: " << node.value << endl;
-    if (node.children.size() > 0) {
-        cout << tabulations << "Child " << endl;
-        for (int i = 0; i < node.children.size(); i++) {
-            printASTTree(node.children[i], tabs + 1);
-        }
-    }
-    if(node.expression.size() > 0) {
-        cout << tabulations << "Expression " << endl;
-        for (int i = 0; i < node.expression.size(); i++) {
-            printASTTree(node.expression[i], tabs + 1);
-        }
-    } 
-    if (node.parameters.size() > 0) {
-        cout << tabulations << "Parameter " << endl;
-        for (int i = 0; i < node.parameters.size(); i++) {
-            printASTTree(node.parameters[i], tabs + 1);
-        }
+//Rewrites a node into the literal of a folded value
+void makeLiteral(AST& ast, ASTNode& node, const Value& value) {
+    node.parameterList = NodeList();
+    node.expressionList = NodeList();
+    if (value.type == VALUE_NUMBER) {
+        node.type = AST_NUMBER;
+        node.integer = value.integer;
+        ast.strings.push_back(to_string(value.integer));
+        node.value = ast.strings.back();
+    } else if (value.type == VALUE_BOOLEAN) {
+        node.type = AST_BOOLEAN;
+        node.integer = value.boolean;
+        node.value = value.boolean ? "true" : "false";
+    } else {
+        node.type = AST_STRING;
+        ast.strings.push_back(value.str());
+        node.value = ast.strings.back();
     }
 }
 
 //INTERPRETER
-void interpret(ASTNode program) {
-    for (int i=0; i<program.children.size(); i++) {
-        traverse(program.children[i]);
+void interpret(const ASTNode& program) {
+    for (int i=0; i<program.children().size(); i++) {
+        traverse(program.children()[i]);
     }
 }
 
-Symbol traverse(ASTNode node) {
-    if (DEBUG) cout << "Traversing node of type " << node.type << endl;
-    unordered_map<string, Symbol> variables2 = variables;
+Value traverse(const ASTNode& node) {
+    if (DEBUG) cout << "Traversing node of type " << AST_NAMES[node.type] << endl;
+    if (stats.enabled) stats.evaluations[node.type] ++;
 
     if (node.type == AST_ASSIGMENT) {
+        if (node.expression().size() == 0) error() << "ERROR: Assigment without expression at line: " << node.line << endl;
 
-        Symbol symbol = Symbol();
-        string symbolName = node.symbol;
-        symbol.line = node.line;
-
-        if (node.expression.size() == 0) cout << "ERROR: Assigment without expression at line: " << node.line << endl;
+        //x[i] = v, the list index node writes the element in place
+        const ASTNode& expression = node.expression()[0];
+        if (expression.type == AST_LIST_INDEX && expression.expression().size() > 0) return traverse(expression);
 
-        symbol = traverse(node.expression[0]);
-        variables[symbolName] = symbol;
+        Value value = traverse(node.expression()[0]);
+        variable(node) = value;
 
-        return symbol;
+        return value;
     }
 
     if (node.type == AST_FUNCTION) {
-        Symbol function = Symbol();
-        string functionName = node.symbol;
-        function.function = node;
-        function.line = node.line;
-        function.type = "function";
-        variables[functionName] = function;
+        variable(node) = makeFunction(&node);
     }
 
-    if (node.type == AST_FUNCTION_CALL) {
-        if (node.symbol == "print") {
-            if (node.expression.size() == 0) cout << "ERROR: Print without expression at line: " << node.line << endl;
-            for (int i=0; i<node.expression[0].expression.size(); i++) {
-                Symbol toPrint = traverse(node.expression[0].expression[i]);
-                if (toPrint.type == AST_NUMBER) cout << toPrint.integer << " ";
-                if (toPrint.type == AST_STRING) cout << toPrint.str << " ";
-                if (toPrint.type == AST_LIST) {
-                    cout << "[";
-                    for (int i=0; i<toPrint.list.size(); i++) {
-                        cout << toPrint.list[i];
-                        if (i != toPrint.list.size() - 1) cout << ", ";
-                    }
-                    cout << "] ";
-                }
-            }
-
-            cout << endl;
-        }
-
-        if (node.symbol == "len") {
-            if (node.expression.size() == 0) cout << "ERROR: Len without expression at line:" << node.line << endl;
-            Symbol list = traverse(node.expression[0]);
-            if (list.type != AST_LIST) { 
-                cout << "ERROR: Len called on non list at line: " << node.line << endl;
-                exit(1);
-            }
-            Symbol length = Symbol();
-            length.type = AST_NUMBER;
-            length.integer = list.list.size();
-            length.line = node.line;
-            return length;
-        }
-
-        if (node.symbol == "if") {
-            Symbol condition = traverse(node.parameters[0]);
-            
-            if (condition.boolean) {
-                //If condition is true
-                for (int i = 0; i < node.children.size(); i++) {
-                    traverse(node.children[i]);
-                }
-            } else if (node.expression.size() > 0) {
-                //if condition is false
-                traverse(node.expression[0]);
-            }
+    if (node.type == AST_IF) {
+        //Only the branch taken is evaluated, the other one is skipped as a whole
+        NodeRange<const ASTNode> branch = isTrue(traverse(node.parameters()[0])) ? node.children() : node.expression();
+        for (int i = 0; i < branch.size() && !callStack.returning(); i++) {
+            traverse(branch[i]);
         }
+        return Value();
+    }
 
-        if (node.symbol == "else") {
-            for (int i = 0; i < node.children.size(); i++) {
-                traverse(node.children[i]);
-            }
+    if (node.type == AST_BLOCK) {
+        for (int i = 0; i < node.children().size() && !callStack.returning(); i++) {
+            traverse(node.children()[i]);
         }
+        return Value();
+    }
 
-        if (variables.find(node.symbol) != variables.end()) {
-            ASTNode function = variables[node.symbol].function;
-
-            //Get parameters
-            for (int i = 0; i < function.parameters.size(); i++) {
-                string parameterName = function.parameters[i].symbol;
-                Symbol parameterValue = traverse(node.parameters[i]);
-                variables[parameterName] = parameterValue;
+    if (node.type == AST_BUILTIN) {
+        if (node.builtin == BUILTIN_PRINT) {
+            if (node.expression().size() == 0) error() << "ERROR: Print without expression at line: " << node.line << endl;
+            for (int i=0; i<node.expression()[0].expression().size(); i++) {
+                printValue(traverse(node.expression()[0].expression()[i]));
             }
 
-            //Execute function
-            for (int i = 0; i < function.children.size(); i++) {
-                if (function.children[i].type == AST_RETURN) {
-                    return traverse(function.children[i]);
-                }
-                traverse(function.children[i]);
-            }
-            return Symbol();
+            output.endLine();
+            return Value();
         }
-    }
-
-    if (node.type == AST_OPERATION) {
-        Symbol term1 = traverse(node.parameters[0]);
-        Symbol term2 = traverse(node.parameters[1]);
 
-        if (term1.type != term2.type) {
-            cout << "ERROR: cannot operate " << term1.type << " with " << term2.type << ". At line: " << node.line << endl;
-            exit(1);
+        if (node.expression().size() == 0) error() << "ERROR: Len without expression at line:" << node.line << endl;
+        Value list = traverse(node.expression()[0]);
+        if (list.type != VALUE_LIST) {
+            error() << "ERROR: Len called on non list at line: " << node.line << endl;
+            throw ScriptError();
         }
+        return makeNumber(list.list().size);
+    }
 
-        Symbol result = Symbol();
-        result.line = node.line;
-
-        //SUM
-        if (node.value == "+") {
-            if (term1.type == AST_LIST && term2.type == AST_LIST) {
-                Symbol newList = Symbol();
-                newList.type = AST_LIST;
-                newList.line = node.line;
-                vector<int> list;
-                for (int i = 0; i < term1.list.size(); i++) {
-                    list.push_back(term1.list[i]);
-                }
-                for (int i = 0; i < term2.list.size(); i++) {
-                    list.push_back(term2.list[i]);
-                }
-                newList.list = list;
-                return newList;
-            }
-
-            result.type = AST_NUMBER;
-            result.integer = term1.integer + term2.integer;
-            return result;
-        }
+    if (node.type == AST_FUNCTION_CALL) {
+        if (node.slot < 0) return Value();
 
-        //COMPARISON
-        if (node.value == "==") {
-            result.type = AST_BOOLEAN;
-            if (term1.type == AST_NULL) {
-                result.boolean = false;
-            } else if (term2.type == AST_NULL) {
-                result.boolean = false;
-            } else {
-                result.boolean = term1.integer == term2.integer;
-            }
-            return result;
+        //Get parameters, they are evaluated in the frame of the caller before the callee is checked, like the virtual
+        //machine does
+        for (int i = 0; i < node.parameters().size(); i++) {
+            callStack.arguments.push_back(traverse(node.parameters()[i]));
         }
 
-        //GREATER THAN
-        if (node.value == ">") {
-            result.type = AST_BOOLEAN;
-            result.boolean = term1.integer > term2.integer;
-            return result;
+        //Inline cache: the call site remembers the last function it called, whose arity has been checked
+        const Value& callee = variable(node);
+        if (callee.type != VALUE_FUNCTION || callee.function != node.callee) checkCall(callee, node, node.parameters().size(), node.callee);
+        const ASTNode& function = *callee.function;
+        if (callStack.size() == MAX_CALL_DEPTH) {
+            error() << "ERROR: Maximum call depth exceeded at line: " << node.line << endl;
+            throw ScriptError();
         }
 
-        //LESS THAN
-        if (node.value == "<") {
-            result.type = AST_BOOLEAN;
-            result.boolean = term1.integer < term2.integer;
-            return result;
+        //Execute function until its end or a return
+        Frame& frame = callStack.push(function.frameSize, node.parameters().size());
+        if (profiler.enabled) profiler.enter(function, node.line);
+        for (int i = 0; i < function.children().size() && !frame.returned; i++) {
+            traverse(function.children()[i]);
         }
+        if (profiler.enabled) profiler.exit();
+        return callStack.pop();
+    }
 
-        //GREATER THAN OR EQUAL
-        if (node.value == ">=") {
-            result.type = AST_BOOLEAN;
-            result.boolean = term1.integer >= term2.integer;
-            return result;
+    if (node.type == AST_OPERATION) {
+        const ASTNode& left = node.parameters()[0];
+        const ASTNode& right = node.parameters()[1];
+        bool integerKind = node.operation >= OPERATION_ADD_INT && node.operation <= OPERATION_GREATER_EQUAL_INT;
+
+        //Number literals and number variables are read without evaluating their nodes
+        int integer1, integer2;
+        if (integerKind && integerOf(left, integer1) && integerOf(right, integer2)) {
+            if (stats.enabled) {
+                stats.evaluations[left.type] ++;
+                stats.evaluations[right.type] ++;
+            }
+            return operateIntegers(node.operation, integer1, integer2);
         }
 
-        //LESS THAN OR EQUAL
-        if (node.value == "<=") {
-            result.type = AST_BOOLEAN;
-            result.boolean = term1.integer <= term2.integer;
-            return result;
+        Value term1 = traverse(left);
+        Value term2 = traverse(right);
+        if (integerKind && term1.type == VALUE_NUMBER && term2.type == VALUE_NUMBER) {
+            return operateIntegers(node.operation, term1.integer, term2.integer);
         }
-
-        //DIFFERENT
-        if (node.value == "!=") {
-            result.type = AST_BOOLEAN;
-            result.boolean = term1.integer != term2.integer;
-            return result;
+        if (node.operation == OPERATION_CONCAT_LIST && term1.type == VALUE_LIST && term2.type == VALUE_LIST) {
+            return concatenate(term1.list(), term2.list());
         }
-
-        cout << "ERROR: Operation not implemented at line: " << node.line << endl;
-        exit(0);
+        return operate(operatorOf(node.value), term1, term2, node.line);
     }
 
     if (node.type == AST_EXPRESSION) {
-        return traverse(node.expression[0]);
+        if (node.expression().size() == 0) return Value();
+        return traverse(node.expression()[0]);
     }
 
     if (node.type == AST_NUMBER) {
-        Symbol symbol = Symbol();
-        symbol.type = "NUMBER";
-        symbol.integer = stoi(node.value);
-        symbol.line = node.line;
-        return symbol;
+        return makeNumber(node.integer);
     }
 
     if (node.type == AST_STRING) {
-        Symbol symbol = Symbol();
-        symbol.type = "STRING";
-        symbol.str = node.value;
-        symbol.line = node.line;
-        return symbol;
+        return makeString(node.value);
     }
 
     if (node.type == AST_BOOLEAN) {
-        Symbol symbol = Symbol();
-        symbol.type = "BOOLEAN";
-        symbol.boolean = node.value == "true";
-        symbol.line = node.line;
-        return symbol;
+        return makeBoolean(node.integer);
     }
 
     if (node.type == AST_LIST) {
-        Symbol symbol = Symbol();
-        symbol.type = "LIST";
-        symbol.line = node.line;
-        for (int i=0; i<node.expression.size(); i++) {
-            Symbol listElement = traverse(node.expression[i]);
-            symbol.list.push_back(listElement.integer);
+        if (node.constant != nullptr) return *node.constant;
+        Value list = makeList(node.expression().size());
+        for (int i=0; i<node.expression().size(); i++) {
+            list.list()[i] = listInteger(traverse(node.expression()[i]), "List elements must be numbers", node.line);
         }
-        return symbol;
+        return list;
     }
 
     if (node.type == AST_NULL) {
-        Symbol symbol = Symbol();
-        symbol.type = "NULL";
-        symbol.line = node.line;
-        return symbol;
+        return makeNull();
     }
 
     if (node.type == AST_LIST_INDEX) {
-        if (variables.find(node.symbol) != variables.end()) {
-            Symbol symbol = variables[node.symbol];
-            if (node.expression.size() > 0) {
-                Symbol parameter = traverse(node.parameters[0]);
-                Symbol expression = traverse(node.expression[0]);
-                symbol.list[parameter.integer] = expression.integer;
-                return symbol;
-            } else {
-                Symbol result = Symbol();
-                result.type = AST_NUMBER;
-                result.line = node.line;
-                result.integer = symbol.list[traverse(node.parameters[0]).integer];
-                return result;
-            }
-        } else {
-            cout << "ERROR: Variable " << node.symbol << " not found at line: " << node.line << endl;
-            exit(1);
+        //Same order as the virtual machine: a read loads the variable before the index is evaluated, an assigment
+        //evaluates the index and the element first. Only then are the list, the index and the element checked
+        bool assigment = node.expression().size() > 0;
+        if (!assigment && variable(node).type == VALUE_UNDEFINED) {
+            error() << "ERROR: Variable " << node.symbol << " not found at line: " << node.line << endl;
+            throw ScriptError();
+        }
+
+        //Evaluating the index or the element can call functions and grow the call stack, the variable is looked up after
+        Value index = traverse(node.parameters()[0]);
+        Value element = assigment ? traverse(node.expression()[0]) : Value();
+        Value& stored = variable(node);
+        int position = checkIndex(stored, index, node);
+
+        if (assigment) {
+            //Assigments write the element in place, the list is only copied if another value shares it
+            writableList(stored)[position] = listInteger(element, "List elements must be numbers", node.line);
+            return Value();
         }
+        return makeNumber(stored.list()[position]);
     }
 
     if (node.type == AST_RETURN) {
-        return traverse(node.expression[0]);
+        Value result = traverse(node.expression()[0]);
+        if (callStack.size() > 0) {
+            callStack.top().result = result;
+            callStack.top().returned = true;
+        }
+        return result;
     }
 
     if (node.type == AST_IDENTIFIER) {
-        if(variables.find(node.symbol) != variables.end()) {
-            return variables[node.symbol];
+        const Value& stored = variable(node);
+        if (stored.type != VALUE_UNDEFINED) {
+            return stored;
+        } else {
+            error() << "ERROR: Variable " << node.symbol << " not found at line: " << node.line << endl;
+            throw ScriptError();
+        }
+    }
+    return Value();
+}
+
+//BYTECODE COMPILER
+//Compiles the resolved AST into linear stack machine code. Function bodies are emitted inline and jumped over
+Bytecode compile(ASTNode& program) {
+    Bytecode bytecode;
+    for (ASTNode& statement : program.children()) compileStatement(bytecode, statement);
+    emit(bytecode, OP_HALT, program);
+    return bytecode;
+}
+
+//Appends an instruction and returns its address
+int emit(Bytecode& bytecode, OpCode op, const ASTNode& source, int operand, int count) {
+    Instruction instruction;
+    instruction.op = op;
+    instruction.operand = operand;
+    instruction.count = count;
+    bytecode.code.push_back(instruction);
+    bytecode.sources.push_back(&source);
+    return bytecode.code.size() - 1;
+}
+
+//Adds a value to the constant pool and returns its index
+int addConstant(Bytecode& bytecode, Value value) {
+    bytecode.constants.push_back(move(value));
+    return bytecode.constants.size() - 1;
+}
+
+//Statements leave the value stack as they found it
+void compileStatement(Bytecode& bytecode, ASTNode& node) {
+    if (node.type == AST_ASSIGMENT && node.expression()[0].type == AST_LIST_INDEX && node.expression()[0].expression().size() > 0) {
+        ASTNode& listIndex = node.expression()[0];
+        compileExpression(bytecode, listIndex.parameters()[0]);
+        compileExpression(bytecode, listIndex.expression()[0]);
+        emit(bytecode, listIndex.local ? OP_SET_INDEX_LOCAL : OP_SET_INDEX_GLOBAL, listIndex, listIndex.slot);
+        return;
+    }
+
+    if (node.type == AST_ASSIGMENT) {
+        compileExpression(bytecode, node.expression()[0]);
+        emit(bytecode, node.local ? OP_STORE_LOCAL : OP_STORE_GLOBAL, node, node.slot);
+        return;
+    }
+
+    if (node.type == AST_FUNCTION) {
+        int skip = emit(bytecode, OP_JUMP, node);
+        node.entry = bytecode.code.size();
+        for (ASTNode& child : node.children()) compileStatement(bytecode, child);
+        emit(bytecode, OP_PUSH_NONE, node);
+        emit(bytecode, OP_RETURN, node);
+        bytecode.code[skip].operand = bytecode.code.size();
+
+        emit(bytecode, OP_PUSH_CONSTANT, node, addConstant(bytecode, makeFunction(&node)));
+        emit(bytecode, node.local ? OP_STORE_LOCAL : OP_STORE_GLOBAL, node, node.slot);
+        return;
+    }
+
+    if (node.type == AST_IF) {
+        compileExpression(bytecode, node.parameters()[0]);
+        int skipThen = emit(bytecode, OP_JUMP_IF_FALSE, node);
+        for (ASTNode& child : node.children()) compileStatement(bytecode, child);
+        if (node.expression().size() > 0) {
+            int skipElse = emit(bytecode, OP_JUMP, node);
+            bytecode.code[skipThen].operand = bytecode.code.size();
+            for (ASTNode& statement : node.expression()) compileStatement(bytecode, statement);
+            bytecode.code[skipElse].operand = bytecode.code.size();
         } else {
-            cout << "ERROR: Variable " << node.symbol << " not found at line: " << node.line << endl;
-            exit(1);
+            bytecode.code[skipThen].operand = bytecode.code.size();
+        }
+        return;
+    }
+
+    if (node.type == AST_BLOCK) {
+        for (ASTNode& child : node.children()) compileStatement(bytecode, child);
+        return;
+    }
+
+    if (node.type == AST_RETURN) {
+        compileExpression(bytecode, node.expression()[0]);
+        emit(bytecode, OP_RETURN, node);
+        return;
+    }
+
+    //Expression statement, its value is discarded
+    compileExpression(bytecode, node);
+    emit(bytecode, OP_POP, node);
+}
+
+//Expressions push exactly one value
+void compileExpression(Bytecode& bytecode, ASTNode& node) {
+    if (node.type == AST_NUMBER) {
+        emit(bytecode, OP_PUSH_CONSTANT, node, addConstant(bytecode, makeNumber(node.integer)));
+    } else if (node.type == AST_STRING) {
+        emit(bytecode, OP_PUSH_CONSTANT, node, addConstant(bytecode, makeString(node.value)));
+    } else if (node.type == AST_BOOLEAN) {
+        emit(bytecode, OP_PUSH_CONSTANT, node, addConstant(bytecode, makeBoolean(node.integer)));
+    } else if (node.type == AST_NULL) {
+        emit(bytecode, OP_PUSH_CONSTANT, node, addConstant(bytecode, makeNull()));
+    } else if (node.type == AST_IDENTIFIER) {
+        emit(bytecode, node.local ? OP_LOAD_LOCAL : OP_LOAD_GLOBAL, node, node.slot);
+    } else if (node.type == AST_LIST && node.constant != nullptr) {
+        emit(bytecode, OP_PUSH_CONSTANT, node, addConstant(bytecode, *node.constant));
+    } else if (node.type == AST_LIST) {
+        for (ASTNode& element : node.expression()) compileExpression(bytecode, element);
+        emit(bytecode, OP_MAKE_LIST, node, node.expression().size());
+    } else if (node.type == AST_LIST_INDEX) {
+        emit(bytecode, node.local ? OP_LOAD_LOCAL : OP_LOAD_GLOBAL, node, node.slot);
+        compileExpression(bytecode, node.parameters()[0]);
+        emit(bytecode, OP_INDEX, node);
+    } else if (node.type == AST_OPERATION) {
+        compileExpression(bytecode, node.parameters()[0]);
+        compileExpression(bytecode, node.parameters()[1]);
+        //Operation kinds map to opcodes in the same order, the operator is kept for the generic path
+        OpCode op = node.operation == OPERATION_GENERIC ? OP_OPERATION : OpCode(OP_ADD_INT + node.operation - OPERATION_ADD_INT);
+        emit(bytecode, op, node, operatorOf(node.value));
+    } else if (node.type == AST_EXPRESSION && node.expression().size() > 0) {
+        compileExpression(bytecode, node.expression()[0]);
+    } else if (node.type == AST_BUILTIN && node.builtin == BUILTIN_PRINT) {
+        for (ASTNode& argument : node.expression()[0].expression()) {
+            compileExpression(bytecode, argument);
+            emit(bytecode, OP_PRINT_VALUE, node);
+        }
+        emit(bytecode, OP_PRINT_END, node);
+    } else if (node.type == AST_BUILTIN && node.builtin == BUILTIN_LEN) {
+        compileExpression(bytecode, node.expression()[0]);
+        emit(bytecode, OP_LENGTH, node);
+    } else if (node.type == AST_FUNCTION_CALL && node.slot >= 0) {
+        for (ASTNode& argument : node.parameters()) compileExpression(bytecode, argument);
+        bytecode.callSites.push_back(CallSite{(int)node.parameters().size()});
+        emit(bytecode, node.local ? OP_CALL_LOCAL : OP_CALL_GLOBAL, node, node.slot, bytecode.callSites.size() - 1);
+    } else {
+        emit(bytecode, OP_PUSH_NONE, node);
+    }
+}
+
+//VIRTUAL MACHINE
+//Stack machine that runs compiled bytecode. The locals of a call live on the value stack above the frame base
+void run(const Bytecode& bytecode) {
+    vector<Value> stack;
+    stack.reserve(1024);
+    vector<VMFrame> frames;
+    const Instruction* code = bytecode.code.data();
+    int pc = 0;
+
+    while (true) {
+        const Instruction& instruction = code[pc++];
+        switch (instruction.op) {
+            case OP_PUSH_CONSTANT:
+                stack.push_back(bytecode.constants[instruction.operand]);
+                break;
+
+            case OP_PUSH_NONE:
+                stack.emplace_back();
+                break;
+
+            case OP_LOAD_GLOBAL:
+            case OP_LOAD_LOCAL: {
+                Value value = instruction.op == OP_LOAD_LOCAL ? stack[frames.back().base + instruction.operand] : environment.global(instruction.operand);
+                if (value.type == VALUE_UNDEFINED) {
+                    const ASTNode& source = *bytecode.sources[pc - 1];
+                    error() << "ERROR: Variable " << source.symbol << " not found at line: " << source.line << endl;
+                    throw ScriptError();
+                }
+                stack.push_back(move(value));
+                break;
+            }
+
+            case OP_STORE_GLOBAL:
+                environment.global(instruction.operand) = move(stack.back());
+                stack.pop_back();
+                break;
+
+            case OP_STORE_LOCAL:
+                stack[frames.back().base + instruction.operand] = move(stack.back());
+                stack.pop_back();
+                break;
+
+            case OP_MAKE_LIST: {
+                Value list = makeList(instruction.operand);
+                int first = stack.size() - instruction.operand;
+                for (int i = 0; i < instruction.operand; i++) {
+                    list.list()[i] = listInteger(stack[first + i], "List elements must be numbers", bytecode.sources[pc - 1]->line);
+                }
+                stack.resize(first);
+                stack.push_back(move(list));
+                break;
+            }
+
+            case OP_INDEX: {
+                Value& list = stack[stack.size() - 2];
+                int index = checkIndex(list, stack.back(), *bytecode.sources[pc - 1]);
+                list = makeNumber(list.list()[index]);
+                stack.pop_back();
+                break;
+            }
+
+            case OP_SET_INDEX_GLOBAL:
+            case OP_SET_INDEX_LOCAL: {
+                const ASTNode& source = *bytecode.sources[pc - 1];
+                Value& list = instruction.op == OP_SET_INDEX_LOCAL ? stack[frames.back().base + instruction.operand] : environment.global(instruction.operand);
+                int index = checkIndex(list, stack[stack.size() - 2], source);
+                //The element is written in place, the list is only copied if another value shares it
+                writableList(list)[index] = listInteger(stack.back(), "List elements must be numbers", source.line);
+                stack.resize(stack.size() - 2);
+                break;
+            }
+
+            case OP_OPERATION: {
+                Value& term1 = stack[stack.size() - 2];
+                term1 = operate((Operator)instruction.operand, term1, stack.back(), bytecode.sources[pc - 1]->line);
+                stack.pop_back();
+                break;
+            }
+
+            case OP_ADD_INT:
+            case OP_EQUAL_INT:
+            case OP_NOT_EQUAL_INT:
+            case OP_LESS_INT:
+            case OP_LESS_EQUAL_INT:
+            case OP_GREATER_INT:
+            case OP_GREATER_EQUAL_INT: {
+                Value& term1 = stack[stack.size() - 2];
+                const Value& term2 = stack.back();
+                if (term1.type == VALUE_NUMBER && term2.type == VALUE_NUMBER) {
+                    term1 = operateIntegers(OperationKind(OPERATION_ADD_INT + instruction.op - OP_ADD_INT), term1.integer, term2.integer);
+                } else {
+                    term1 = operate((Operator)instruction.operand, term1, term2, bytecode.sources[pc - 1]->line);
+                }
+                stack.pop_back();
+                break;
+            }
+
+            case OP_CONCAT_LIST: {
+                Value& term1 = stack[stack.size() - 2];
+                const Value& term2 = stack.back();
+                if (term1.type == VALUE_LIST && term2.type == VALUE_LIST) {
+                    term1 = concatenate(term1.list(), term2.list());
+                } else {
+                    term1 = operate((Operator)instruction.operand, term1, term2, bytecode.sources[pc - 1]->line);
+                }
+                stack.pop_back();
+                break;
+            }
+
+            case OP_JUMP:
+                pc = instruction.operand;
+                break;
+
+            case OP_JUMP_IF_FALSE:
+                if (!isTrue(stack.back())) pc = instruction.operand;
+                stack.pop_back();
+                break;
+
+            case OP_CALL_GLOBAL:
+            case OP_CALL_LOCAL: {
+                CallSite& site = bytecode.callSites[instruction.count];
+                const Value& callee = instruction.op == OP_CALL_LOCAL ? stack[frames.back().base + instruction.operand] : environment.global(instruction.operand);
+                if (callee.type != VALUE_FUNCTION || callee.function != site.callee) checkCall(callee, *bytecode.sources[pc - 1], site.arguments, site.callee);
+                const ASTNode& function = *callee.function;
+                if (frames.size() == MAX_CALL_DEPTH) {
+                    error() << "ERROR: Maximum call depth exceeded at line: " << bytecode.sources[pc - 1]->line << endl;
+                    throw ScriptError();
+                }
+
+                //Arguments already on the stack become the first locals
+                VMFrame frame;
+                frame.returnAddress = pc;
+                frame.base = stack.size() - site.arguments;
+                frames.push_back(frame);
+                stack.resize(frame.base + function.frameSize, makeUndefined());
+                pc = function.entry;
+                if (profiler.enabled) profiler.enter(function, bytecode.sources[frame.returnAddress - 1]->line);
+                break;
+            }
+
+            case OP_RETURN: {
+                //A return outside of a function only evaluates its expression
+                if (frames.empty()) {
+                    stack.pop_back();
+                    break;
+                }
+                Value result = move(stack.back());
+                stack.resize(frames.back().base);
+                stack.push_back(move(result));
+                pc = frames.back().returnAddress;
+                frames.pop_back();
+                if (profiler.enabled) profiler.exit();
+                break;
+            }
+
+            case OP_PRINT_VALUE:
+                printValue(stack.back());
+                stack.pop_back();
+                break;
+
+            case OP_PRINT_END:
+                output.endLine();
+                stack.emplace_back();
+                break;
+
+            case OP_LENGTH:
+                if (stack.back().type != VALUE_LIST) {
+                    error() << "ERROR: Len called on non list at line: " << bytecode.sources[pc - 1]->line << endl;
+                    throw ScriptError();
+                }
+                stack.back() = makeNumber(stack.back().list().size);
+                break;
+
+            case OP_POP:
+                stack.pop_back();
+                break;
+
+            case OP_HALT:
+                return;
         }
     }
-    return Symbol();
-}
\ No newline at end of file
+}
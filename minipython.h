@@ -0,0 +1,103 @@
+//MINIPYTHON LIBRARY
+//Embeds the interpreter in a C++ program. An Interpreter loads a script once (lexer, parser, resolver, optimizer and,
+//for the virtual machine, the bytecode compiler) and runs it any number of times. Globals can be set before a run and
+//read after it, print() output and error messages go to a sink chosen by the host (stdout by default).
+//Every Interpreter has its own variables: different instances can run on different threads at the same time, one
+//instance is used by one thread at a time. Build the library from the repository root:
+//  g++ -std=c++17 -O2 -fPIC -fvisibility=hidden -DMINIPYTHON_NO_MAIN -c minipython.cpp -o minipython.o
+//  ar rcs libminipython.a minipython.o               (static)
+//  g++ -shared minipython.o -o libminipython.so      (shared)
+//and link the host with -lminipython after including this header.
+#ifndef MINIPYTHON_H
+#define MINIPYTHON_H
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#define MINIPYTHON_API __attribute__((visibility("default")))
+
+namespace minipython {
+
+enum ScriptType {
+    SCRIPT_NONE,
+    SCRIPT_NUMBER,
+    SCRIPT_STRING,
+    SCRIPT_BOOLEAN,
+    SCRIPT_NULL,
+    SCRIPT_LIST,
+    SCRIPT_FUNCTION, //Only read, the text is the name of the function
+    SCRIPT_UNDEFINED //Variable that does not exist or has not been assigned
+};
+
+//Value of a global variable, copied into and out of the interpreter
+struct ScriptValue {
+    ScriptType type = SCRIPT_NONE;
+    int integer = 0; //Numbers, and booleans as 0 or 1
+    std::string text; //Strings and function names
+    std::vector<int> list;
+
+    ScriptValue() = default;
+    ScriptValue(int integer) : type(SCRIPT_NUMBER), integer(integer) {}
+    ScriptValue(bool boolean) : type(SCRIPT_BOOLEAN), integer(boolean) {}
+    ScriptValue(std::string text) : type(SCRIPT_STRING), text(std::move(text)) {}
+    ScriptValue(const char* text) : ScriptValue(std::string(text)) {}
+    ScriptValue(std::vector<int> list) : type(SCRIPT_LIST), list(std::move(list)) {}
+
+    static ScriptValue undefined() {
+        ScriptValue value;
+        value.type = SCRIPT_UNDEFINED;
+        return value;
+    }
+
+    bool operator==(const ScriptValue& other) const {
+        return type == other.type && integer == other.integer && text == other.text && list == other.list;
+    }
+
+    bool operator!=(const ScriptValue& other) const {
+        return !(*this == other);
+    }
+};
+
+enum Engine {
+    ENGINE_TREE, //Walks the AST
+    ENGINE_VM //Runs bytecode compiled once by load()
+};
+
+class MINIPYTHON_API Interpreter {
+    public:
+        Interpreter();
+        ~Interpreter();
+        Interpreter(Interpreter&& other) noexcept;
+        Interpreter& operator=(Interpreter&& other) noexcept;
+        Interpreter(const Interpreter&) = delete;
+        Interpreter& operator=(const Interpreter&) = delete;
+
+        //Prepares a script to run, replacing the script loaded before. Globals keep their values, except functions of
+        //the previous script. Returns false if the script has a syntax error, its message is written to the output
+        bool load(std::string_view source, Engine engine = ENGINE_TREE);
+
+        //Runs the loaded script with the current globals. Returns false if there is no script or the script stopped
+        //with an error, whose message is written to the output
+        bool run();
+
+        //Unassigns every global
+        void reset();
+
+        //SCRIPT_UNDEFINED unassigns the variable, functions cannot be assigned from the host
+        void setGlobal(const std::string& name, const ScriptValue& value);
+        ScriptValue getGlobal(const std::string& name) const;
+
+        //Receives the output of print() and error messages in blocks, nullptr writes them to stdout
+        void setOutput(std::function<void(std::string_view)> sink);
+
+    private:
+        struct State;
+        std::unique_ptr<State> state;
+};
+
+}
+
+#endif
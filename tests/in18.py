@@ -0,0 +1,38 @@
+#Return from inside nested if and else branches, the statements after the return do not run
+def Sign(n):
+    if n >= 10:
+        if n == 10:
+            return 0
+        return 1
+    else:
+        return 2
+
+def Classify(n):
+    result = "none"
+    if Sign(n) == 1:
+        if n > 100:
+            return "big"
+        else:
+            result = "small"
+            return result
+        result = "unreachable"
+    else:
+        if Sign(n) == 0:
+            return "ten"
+    return "less"
+
+def Count(a, b, c):
+    total = 0
+    if a > 0:
+        total = total + 1
+        if b > 0:
+            total = total + 1
+            if c > 0:
+                return total + 1
+            return total
+        return total
+    return total
+
+print("classify: ", Classify(500), Classify(70), Classify(10), Classify(3))
+print("count: ", Count(1, 1, 1), Count(1, 1, 0), Count(1, 0, 1), Count(0, 1, 1))
+print("sign: ", Sign(30) + Sign(10) + Sign(9))
@@ -0,0 +1,23 @@
+#Comparisons of lists, strings, booleans and numbers, ordering null values is an error
+def B(v):
+    if v:
+        return 1
+    return 0
+
+x = [1,2]
+y = [1,2]
+z = [1,3]
+print(B(x == y), B(x != y), B(x < z), B(z > x), B(x <= y), B([1] < x))
+a = "a"
+b = "b"
+print(B(a < b), B(b < a), B(a != b), B(a == "a"), B("b" >= a), B("ab" > "a"))
+t = True
+f = False
+print(B(t != f), B(t > f), B(t == True))
+n = 3
+m = 4
+print(B(n != m), B(n < m), B(n >= m))
+print(B("a" < "b"), B("a" != "a"), B([1,2] != [1,2]))
+q = None
+w = None
+print(B(q < w))
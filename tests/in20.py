@@ -0,0 +1,5 @@
+#Calling a name that is not a function evaluates the arguments first, then stops with an error in both engines
+print("start")
+g = 5
+g(print("argument"))
+print("not reached")
@@ -0,0 +1,6 @@
+x = [1, True, 3]
+print(x)
+x[0] = False
+print(x, x[True])
+y = ["a", "b"]
+print(y)
@@ -0,0 +1,14 @@
+def at(i):
+    print("index", i)
+    return i
+
+def value(v):
+    print("element", v)
+    return v
+
+x = [1, 2, 3]
+x[at(1)] = 7
+x[0] = value(5)
+print(x[at(2)], x)
+n = 5
+print(n[at(0)])
@@ -0,0 +1,3 @@
+a = 1
+print(a)
+b = a !
\ No newline at end of file
@@ -0,0 +1,248 @@
+//REGRESSION TESTS
+//Runs minipython with both engines on every tests/inXX.py and compares stdout against the golden output tests/outXX.txt.
+//Every run also has to stay within the time and peak memory budgets of tests/budgets.txt, so a performance regression
+//fails the run like a wrong output does. Run from the repository root:
+//  g++ -std=c++17 -O2 tests/run_tests.cpp -o run_tests && ./run_tests [--binary=./minipython] [--update] [in14 ...]
+//--update rewrites the golden outputs from the current build (check the diff before committing them).
+//The exit status is checked too: 1 for a script whose golden output has an error line, 0 otherwise. A crash fails the test
+//even if the output was complete.
+//When every test is selected, the whole directory is also run in one process with --batch, sequentially and on 4 threads,
+//and the output has to be the golden outputs one after the other.
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <filesystem>
+#include <chrono>
+#include <iomanip>
+#include <spawn.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+using namespace std;
+
+extern char** environ;
+
+//Limits of one test, from tests/budgets.txt
+struct Budget {
+    int copies = 1; //Times the script is repeated in the input, so the time is spent running it instead of starting up
+    double milliseconds = 0;
+    long kilobytes = 0;
+};
+
+struct Result {
+    string output;
+    int status = 0; //Exit status, or minus the signal that killed the process
+    double milliseconds = 0; //Fastest run
+    long kilobytes = 0; //Largest peak RSS
+};
+
+const int RUNS = 3;
+
+string readFile(const string& path) {
+    ifstream file(path, ios::binary);
+    return string((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+}
+
+//Reads "name copies time(ms) rss(KB)" lines, the "default" line applies to tests without their own line
+map<string, Budget> readBudgets(const string& path) {
+    map<string, Budget> budgets;
+    istringstream lines(readFile(path));
+    string line;
+    while (getline(lines, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        istringstream fields(line);
+        string name;
+        Budget budget;
+        if (fields >> name >> budget.copies >> budget.milliseconds >> budget.kilobytes) budgets[name] = budget;
+    }
+    return budgets;
+}
+
+//Runs the binary on a script RUNS times with stdout sent to a file, keeping the fastest time and the largest peak RSS.
+//ru_maxrss counts this process too until the interpreter is exec'd, which is why the runner keeps its own memory small
+Result execute(const string& binary, const string& engine, const string& script, const string& outputPath, const vector<string>& flags = {}) {
+    Result result;
+    for (int run = 0; run < RUNS; run++) {
+        posix_spawn_file_actions_t actions;
+        posix_spawn_file_actions_init(&actions);
+        posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, outputPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+        if (!flags.empty()) posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0); //Batch totals
+        string engineFlag = "--engine=" + engine;
+        vector<char*> arguments = {(char*)binary.c_str(), (char*)engineFlag.c_str()};
+        for (const string& flag : flags) arguments.push_back((char*)flag.c_str());
+        arguments.push_back((char*)script.c_str());
+        arguments.push_back(nullptr);
+
+        auto start = chrono::steady_clock::now();
+        pid_t child;
+        if (posix_spawn(&child, binary.c_str(), &actions, nullptr, arguments.data(), environ) != 0) {
+            cout << "ERROR: cannot run " << binary << endl;
+            exit(1);
+        }
+        int status;
+        rusage usage;
+        wait4(child, &status, 0, &usage);
+        double elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        posix_spawn_file_actions_destroy(&actions);
+
+        //The first run that did not exit with 0 decides the status
+        int exitStatus = WIFEXITED(status) ? WEXITSTATUS(status) : -WTERMSIG(status);
+        if (run == 0 || result.status == 0) result.status = exitStatus;
+        if (run == 0 || elapsed < result.milliseconds) result.milliseconds = elapsed;
+        result.kilobytes = max(result.kilobytes, (long)usage.ru_maxrss);
+        result.output = readFile(outputPath);
+    }
+    return result;
+}
+
+//Exit status minipython has to return for a golden output: scripts stopped by an error (ERROR:, or Error: from the
+//lexer) return 1
+int expectedStatus(const string& golden) {
+    for (const string prefix : {"ERROR:", "Error:"}) {
+        if (golden.rfind(prefix, 0) == 0 || golden.find("\n" + prefix) != string::npos) return 1;
+    }
+    return 0;
+}
+
+//Failure message for an exit status that is not the expected one
+string statusFailure(int status, int expected) {
+    if (status < 0) return "FAIL: killed by signal " + to_string(-status);
+    return "FAIL: exit status " + to_string(status) + ", expected " + to_string(expected);
+}
+
+//Line of the first difference between two outputs, for the failure message
+int firstDifference(const string& expected, const string& actual) {
+    int line = 1;
+    for (size_t i = 0; i < min(expected.size(), actual.size()); i++) {
+        if (expected[i] != actual[i]) return line;
+        if (expected[i] == '\n') line++;
+    }
+    return line;
+}
+
+int main(int argc, char* argv[]) {
+    string binary = "./minipython";
+    bool update = false;
+    vector<string> selected;
+    for (int i = 1; i < argc; i++) {
+        string argument = argv[i];
+        if (argument.rfind("--binary=", 0) == 0) binary = argument.substr(9);
+        else if (argument == "--update") update = true;
+        else selected.push_back(argument);
+    }
+
+    vector<string> tests;
+    for (const auto& entry : filesystem::directory_iterator("tests")) {
+        string name = entry.path().stem().string();
+        if (entry.path().extension() != ".py" || name.rfind("in", 0) != 0) continue;
+        if (selected.empty() || find(selected.begin(), selected.end(), name) != selected.end()) tests.push_back(name);
+    }
+    sort(tests.begin(), tests.end());
+    for (const string& name : selected) {
+        if (find(tests.begin(), tests.end(), name) == tests.end()) {
+            cout << "ERROR: no test named " << name << endl;
+            return 1;
+        }
+    }
+    if (tests.empty()) {
+        cout << "ERROR: no tests found in tests/" << endl;
+        return 1;
+    }
+
+    map<string, Budget> budgets = readBudgets("tests/budgets.txt");
+    string temporary = filesystem::temp_directory_path().string() + "/minipython_test_" + to_string(getpid());
+    string scriptPath = temporary + ".py";
+    string outputPath = temporary + ".txt";
+
+    int runs = 0;
+    int failures = 0;
+    if (!update) cout << left << setw(8) << "Test" << setw(8) << "Engine" << setw(8) << "Copies" << setw(12) << "Time (ms)"
+         << setw(12) << "RSS (KB)" << "Result" << endl;
+    for (const string& test : tests) {
+        string number = test.substr(2);
+        string goldenPath = "tests/out" + number + ".txt";
+        string script = readFile("tests/" + test + ".py");
+        if (!script.empty() && script.back() != '\n') script += '\n';
+
+        if (update) {
+            Result result = execute(binary, "tree", "tests/" + test + ".py", outputPath);
+            ofstream(goldenPath, ios::binary) << result.output;
+            cout << "Updated " << goldenPath << endl;
+            continue;
+        }
+
+        auto found = budgets.find(test);
+        if (found == budgets.end()) found = budgets.find("default");
+        Budget budget = found != budgets.end() ? found->second : Budget();
+
+        //The input is the script repeated, the expected output is the golden output repeated. The input is written
+        //out one copy at a time, spawned processes start with the memory of this one until they exec the interpreter
+        ofstream input(scriptPath, ios::binary);
+        for (int i = 0; i < budget.copies; i++) input << script;
+        input.close();
+
+        for (const string engine : {"tree", "vm"}) {
+            Result result = execute(binary, engine, scriptPath, outputPath);
+            runs++;
+
+            string golden = readFile(goldenPath);
+            string expected;
+            for (int i = 0; i < budget.copies; i++) expected += golden;
+
+            string verdict = "ok";
+            if (!filesystem::exists(goldenPath)) {
+                verdict = "FAIL: missing " + goldenPath;
+            } else if (result.output != expected) {
+                verdict = "FAIL: output differs at line " + to_string(firstDifference(expected, result.output));
+            } else if (result.status != expectedStatus(golden)) {
+                verdict = statusFailure(result.status, expectedStatus(golden));
+            } else if (budget.milliseconds > 0 && result.milliseconds > budget.milliseconds) {
+                verdict = "FAIL: over the time budget of " + to_string((int)budget.milliseconds) + " ms";
+            } else if (budget.kilobytes > 0 && result.kilobytes > budget.kilobytes) {
+                verdict = "FAIL: over the memory budget of " + to_string(budget.kilobytes) + " KB";
+            }
+            if (verdict != "ok") failures++;
+
+            cout << setw(8) << test << setw(8) << engine << setw(8) << budget.copies << setw(12) << fixed << setprecision(1)
+                 << result.milliseconds << setw(12) << result.kilobytes << verdict << endl;
+        }
+    }
+
+    //Batch mode: every script once, in name order, in one process
+    if (!update && selected.empty()) {
+        //The batch returns 1 if any of its scripts stopped with an error
+        string expected;
+        int batchStatus = 0;
+        for (const string& test : tests) {
+            string golden = readFile("tests/out" + test.substr(2) + ".txt");
+            expected += golden;
+            batchStatus = max(batchStatus, expectedStatus(golden));
+        }
+        for (const string engine : {"tree", "vm"}) for (const string jobs : {"--jobs=1", "--jobs=4"}) {
+            Result result = execute(binary, engine, "tests", outputPath, {jobs, "--batch"});
+            runs++;
+            string verdict = "ok";
+            if (result.output != expected) {
+                verdict = "FAIL: output differs at line " + to_string(firstDifference(expected, result.output));
+            } else if (result.status != batchStatus) {
+                verdict = statusFailure(result.status, batchStatus);
+            }
+            if (verdict != "ok") failures++;
+            cout << setw(8) << "batch" + jobs.substr(7) << setw(8) << engine << setw(8) << 1 << setw(12) << fixed << setprecision(1)
+                 << result.milliseconds << setw(12) << result.kilobytes << verdict << endl;
+        }
+    }
+    filesystem::remove(scriptPath);
+    filesystem::remove(outputPath);
+
+    if (update) return 0;
+    cout << runs << " runs, " << failures << " failures" << endl;
+    return failures > 0 ? 1 : 0;
+}